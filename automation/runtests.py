@@ -18,10 +18,10 @@ def get_files(basepath, basedir):
   return [dir for dir in os.listdir(basepath) if os.path.isdir(os.path.join(basepath, dir))]
 
 
-def valgrind_test(valgrind, anapath, fullpath):
+def valgrind_test(valgrind, anapath, fullpath, ana_args=[]):
   success = False
   args = [valgrind, "--xml-fd=2", "--xml=yes", "--leak-check=summary", "--show-leak-kinds=all", \
-          "-q", anapath, fullpath]
+          "-q", anapath] + ana_args + [fullpath]
   pipefds = os.pipe()
   readfd = pipefds[0]
   writefd = pipefds[1]
@@ -120,12 +120,14 @@ def run_test(anapath, basedir, testpath):
   contents = open(fullpath).read().split(os.linesep)
   expecation = "PASS"
   stdin_data = None
+  ana_args = []
 
   if contents[0][:2] == '//':
     try:
       spec = json.loads(contents[0][2:])
       expecation = spec['Expect'].upper()
       stdin_data = spec.get('Input')
+      ana_args = spec.get('Args') or []
     except json.JSONDecodeError as e:
       print("warning json.loads:" + e)
 
@@ -153,7 +155,7 @@ def run_test(anapath, basedir, testpath):
     
     os.close(stdin_writefd)
 
-    os.execl(anapath, anapath.split("/").pop(), (fullpath))
+    os.execv(anapath, [anapath.split("/").pop()] + ana_args + [fullpath])
 
     stdout.close()
 
@@ -233,6 +235,7 @@ def main():
       
       expecation = "PASS"
       stdin_data = None
+      ana_args = []
       should_skip = False
 
       if contents[0][:2] == '//':
@@ -240,6 +243,7 @@ def main():
           spec = json.loads(contents[0][2:])
           expecation = spec['Expect'].upper()
           stdin_data = spec.get('Input')
+          ana_args = spec.get('Args') or []
           should_skip = spec.get("Skip")
         except json.JSONDecodeError as e:
           print("warning json.loads:" + str(e))
@@ -276,7 +280,7 @@ def main():
         
         os.close(stdin_writefd)
 
-        os.execl(ana, ana.split("/").pop(), (fullpath))
+        os.execv(ana, [ana.split("/").pop()] + ana_args + [fullpath])
 
         stdout.close()
 
@@ -303,7 +307,7 @@ def main():
 
           else:
             if expecation != 'FAIL':
-              valgrindresult = valgrind_test(valgrind, ana, fullpath)
+              valgrindresult = valgrind_test(valgrind, ana, fullpath, ana_args)
               if valgrindresult is not None and valgrindresult != -1:
                 print("%s: %s/%s " % (FAIL, dir, fullpath.split("/").pop()))
                 print(valgrindresult)
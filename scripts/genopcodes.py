@@ -0,0 +1,60 @@
+#!/usr/bin/env python
+
+import os
+import re
+
+def getOpcodes(path):
+  regex = re.compile('^\s*#define\s+([A-Z_]+)\s+(0[xX][0-9a-fA-F]+)\s*$')
+  opcodes = {}
+
+  for line in open(path, "r").read().split("\n"):
+    match = regex.match(line)
+    if match and match.group(1) != "ANA_LAST_OPCODE":
+      opcodes[int(match.group(2), 16)] = match.group(1)
+
+  return opcodes
+
+
+def getTargets(path):
+  regex = re.compile('vm_target\(([A-Z_]+)\)')
+
+  return set(regex.findall(open(path, "r").read()))
+
+
+def getOpcodesPath():
+  return os.path.realpath("./../src/include/opcodes.h");
+
+
+def getVmPath():
+  return os.path.realpath("./../src/vm/frame_eval.h");
+
+
+opcodes = getOpcodes(getOpcodesPath())
+targets = getTargets(getVmPath())
+
+lines = [];
+
+lines.append("/* Generated by scripts/genopcodes.py from opcodes.h, do not edit */")
+lines.append("static void *opcode_targets[256] = {");
+
+for i in range(256):
+    # opcodes without a handler in the vm fall through to the default target
+    if i in opcodes and opcodes[i] in targets:
+        target = "&&target_%s" % opcodes[i]
+    else:
+        target = "&&target_default"
+
+    if i + 1 == 256:
+        lines.append('  %s' % target);
+    else:
+        lines.append('  %s,' % target);
+
+lines.append("};");
+
+output = open('./../src/include/opcode_targets.h', 'w');
+
+for line in lines:
+    if len(line) > 0:
+        output.write(line + "\n");
+
+output.close();
@@ -35,6 +35,9 @@ typedef struct ana_options {
   int error;
   int livetracing;
   int disable_gc;
+  long max_stack_depth;
+  long gc_pause;
+  long gc_threads;
 } ana_options;
 
 const char *shorthelpstr = "\
@@ -52,6 +55,11 @@ options and arguments:\n\
   -h, --help                display this menu\n\
   -d, --debug               print C debugging messages to stderr\n\
   -g  --disable-gc          diable the garbage collector\n\
+  -p, --gc-pause <us>       collect the old generation in slices of about\n\
+                            that many microseconds instead of all at once\n\
+  -t, --gc-threads <n>      mark full collections with n threads, defaults\n\
+                            to ANA_GC_THREADS from the environment or 1\n\
+  -s, --max-stack-depth <n> how deep calls can nest, defaults to 65536\n\
   command                   a string of ana source code\n\
   file                      path to the file to be executed\n\
   args                      arguments passed to the ana program\n\
@@ -76,6 +84,8 @@ static int usage(int status)
 static struct option long_options[] = {
   { "debug",        no_argument,       NULL, 'd'},
   { "disable-gc",   no_argument,       NULL, 'g'},
+  { "gc-pause",     required_argument, NULL, 'p'},
+  { "gc-threads",   required_argument, NULL, 't'},
   { "ast",          no_argument,       NULL, 'a'},
   { "opcodes",      no_argument,       NULL, 'o'},
   { "interactive",  no_argument,       NULL, 'i'},
@@ -84,6 +94,7 @@ static struct option long_options[] = {
   { "version",      no_argument,       NULL, 'v'},
   { "live-tracing", no_argument,       NULL, 'l'},
   { "help",         no_argument,       NULL, 'h'},
+  { "max-stack-depth", required_argument, NULL, 's'},
   {0, 0, 0, 0}
 };
 
@@ -95,11 +106,24 @@ static ana_options parse_argv(int argc, char **argv)
 
   memset(&ret, 0, sizeof(ana_options));
 
+  /* the command line takes precedence */
+  if(getenv("ANA_GC_THREADS"))
+  {
+    ret.gc_threads = strtol(getenv("ANA_GC_THREADS"), NULL, 10);
+    if(ret.gc_threads <= 0)
+    {
+      fprintf(stdout, "%s: invalid ANA_GC_THREADS '%s'\n", 
+        PROGRAM_NAME, getenv("ANA_GC_THREADS"));
+      ret.error = 1;
+      return ret;
+    }
+  }
+
   for(;;)
   {
     opterr = 1;
 
-    c = getopt_long(argc, argv, "gdaoic:f:vhl", long_options, &option_index);
+    c = getopt_long(argc, argv, "gp:t:daoic:f:vhls:", long_options, &option_index);
 
     if(c == -1)
       break;
@@ -111,6 +135,26 @@ static ana_options parse_argv(int argc, char **argv)
       case 'g':
         ret.disable_gc = 1;
         break;
+      case 'p':
+        ret.gc_pause = strtol(optarg, NULL, 10);
+        if(ret.gc_pause <= 0)
+        {
+          fprintf(stdout, "%s: invalid gc pause '%s'\n", 
+            PROGRAM_NAME, optarg);
+          ret.error = 1;
+          goto exit;
+        }
+        break;
+      case 't':
+        ret.gc_threads = strtol(optarg, NULL, 10);
+        if(ret.gc_threads <= 0)
+        {
+          fprintf(stdout, "%s: invalid gc threads '%s'\n", 
+            PROGRAM_NAME, optarg);
+          ret.error = 1;
+          goto exit;
+        }
+        break;
       case 'l':
         ret.livetracing = 1;
         break;
@@ -139,6 +183,16 @@ static ana_options parse_argv(int argc, char **argv)
       case 'h':
         ret.help = 1;
         break;
+      case 's':
+        ret.max_stack_depth = strtol(optarg, NULL, 10);
+        if(ret.max_stack_depth <= 0)
+        {
+          fprintf(stdout, "%s: invalid max stack depth '%s'\n", 
+            PROGRAM_NAME, optarg);
+          ret.error = 1;
+          goto exit;
+        }
+        break;
       case '?':
         ret.error = 1;
         goto exit;
@@ -311,6 +365,15 @@ static int run_file(ana_options *opts)
 
     if(opts->disable_gc)
       vm->flags |= COMO_VM_GC_DISABLED;
+
+    if(opts->gc_pause > 0)
+      ana_vm_set_gc_pause(vm, (ana_size_t)opts->gc_pause);
+
+    if(opts->gc_threads > 1)
+      ana_vm_set_gc_threads(vm, (int)opts->gc_threads);
+
+    if(opts->max_stack_depth > 0)
+      ana_vm_set_max_stack_depth(vm, (ana_size_t)opts->max_stack_depth);
     
     if(opts->ast)
     {
@@ -363,6 +426,15 @@ static int eval_ast(ana_options *opts, node *ast, const char *filename)
 
   if(opts->disable_gc)
     vm->flags |= COMO_VM_GC_DISABLED;
+
+  if(opts->gc_pause > 0)
+    ana_vm_set_gc_pause(vm, (ana_size_t)opts->gc_pause);
+
+  if(opts->gc_threads > 1)
+    ana_vm_set_gc_threads(vm, (int)opts->gc_threads);
+
+  if(opts->max_stack_depth > 0)
+    ana_vm_set_max_stack_depth(vm, (ana_size_t)opts->max_stack_depth);
   
   if(opts->ast)
   {
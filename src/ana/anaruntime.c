@@ -1,18 +1,33 @@
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <ana.h>
 
-static char *ana_excep__IMPL = NULL;
-static char *ana_except_type__IMPL = NULL;
+char *ana__excep = NULL;
+char *ana__except_type = NULL;
+
+static char excep_storage[ANA_EXCEPTION_MESSAGE_MAX];
 
 char **ana__excep_location(void)
 {
-  return &ana_excep__IMPL;
+  return &ana__excep;
 }
 
 char **ana__except_type_location(void)
 {
-  return &ana_except_type__IMPL;
+  return &ana__except_type;
+}
+
+void ana__set_error(const char *type, const char *fmt, ...)
+{
+  va_list args;
+
+  va_start(args, fmt);
+  vsnprintf(excep_storage, sizeof(excep_storage), fmt, args);
+  va_end(args);
+
+  ana__except_type = (char *)type;
+  ana__excep = excep_storage;
 }
 
 COMO_OBJECT_API char *ana_get_fn_name(ana_frame * frame)
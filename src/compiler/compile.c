@@ -64,10 +64,7 @@
 
 #define EMITX(vm, func, opcode, arg, flag, ast) do { \
   EMIT(func, opcode, arg, flag); \
-  ana_map_put(func->line_mapping, \
-      ana_longfromlong(func->code_size), \
-      ana_longfromlong((long)ast->line) \
-  ); \
+  ana_function_defn_addline(func, func->code_size - 1, ast->line); \
 } while(0)
 
 
@@ -79,6 +76,367 @@ static void ana_compile_unit_jumps(ana_vm *vm, ana_object *funcobj, node *ast,
 static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj, 
   node *ast, int *break_address_index, int *continue_address_index);
 
+static int name_list_has(ana_object *list, char *name)
+{
+  ana_array_foreach(list, index, value) {
+    (void)index;
+    if(strcmp(ana_cstring(value), name) == 0)
+      return 1;
+  } ana_array_foreach_end();
+
+  return 0;
+}
+
+static void name_list_add(ana_object *list, char *name)
+{
+  if(!name_list_has(list, name))
+    ana_array_push(list, ana_stringfromstring(name));
+}
+
+/* 
+ * Collects the names a function body assigns to, and the names bound by
+ * opcodes that write the locals map themselves. Nested function and class
+ * bodies have their own scope and are not visited
+ */
+static void collect_names(node *ast, ana_object *assigned, ana_object *bound)
+{
+  int i;
+
+  if(ast == NULL)
+    return;
+
+  switch(ast->kind)
+  {
+    case COMO_AST_FUNCTION:
+    case COMO_AST_CLASS:
+      name_list_add(bound, ((node_id *)ast->children[0])->value);
+      return;
+    case COMO_AST_IMPORT:
+      if(ast->nchild == 2 && ast->children[1] != NULL)
+      {
+        name_list_add(bound, ((node_id *)ast->children[1])->value);
+      }
+      else
+      {
+        node *importlist = ast->children[0];
+        name_list_add(bound, 
+          ((node_id *)importlist->children[importlist->nchild - 1])->value);
+      }
+      return;
+    case COMO_AST_TRY:
+      name_list_add(bound, ((node_id *)ast->children[1])->value);
+      break;
+    case COMO_AST_FOREACH:
+      name_list_add(assigned, ((node_id *)ast->children[0])->value);
+      break;
+    case COMO_AST_PREFIXINC:
+    case COMO_AST_PREFIXDEC:
+    case COMO_AST_POSTFIXINC:
+    case COMO_AST_POSTFIXDEC:
+      if(ast->children[0]->kind == COMO_AST_ID)
+        name_list_add(assigned, ((node_id *)ast->children[0])->value);
+      break;
+    case COMO_AST_BINOP:
+      if((ast->attributes == COMO_AST_ASSIGN 
+            || ast->attributes == COMO_AST_PLUS_ASSIGN)
+          && ast->children[0]->kind == COMO_AST_ID)
+        name_list_add(assigned, ((node_id *)ast->children[0])->value);
+      break;
+    default:
+      break;
+  }
+
+  for(i = 0; i < ast->nchild; i++)
+  {
+    collect_names(ast->children[i], assigned, bound);
+  }
+}
+
+/*
+ * Gives the parameters, and for plain functions the names assigned in the
+ * body, a frame slot so they are accessed with LOAD_FAST and STORE_FAST.
+ * In methods an assignment stores an instance property, so only the 
+ * parameters are slotted there. A parameter that is also bound by name, 
+ * or in a method assigned to, keeps the whole function on the locals map
+ */
+static void compile_locals(ana_function_defn *func, node *body, int ismethod)
+{
+  ana_object *assigned = ana_array_new(4);
+  ana_object *bound = ana_array_new(4);
+
+  collect_names(body, assigned, bound);
+
+  ana_array_foreach(func->parameters, index, value) {
+    (void)index;
+    if(name_list_has(bound, ana_cstring(value)))
+      goto done;
+    if(ismethod && name_list_has(assigned, ana_cstring(value)))
+      goto done;
+  } ana_array_foreach_end();
+
+  ana_array_foreach(func->parameters, index, value) {
+    (void)index;
+    ana_function_defn_addlocal(func, ana_cstring(value));
+  } ana_array_foreach_end();
+
+  if(!ismethod)
+  {
+    ana_array_foreach(assigned, index, value) {
+      (void)index;
+      if(!name_list_has(bound, ana_cstring(value)))
+        ana_function_defn_addlocal(func, ana_cstring(value));
+    } ana_array_foreach_end();
+  }
+
+done:
+  ana_array_foreach_apply(assigned, ana_object_dtor);
+  ana_object_dtor(assigned);
+  ana_array_foreach_apply(bound, ana_object_dtor);
+  ana_object_dtor(bound);
+}
+
+/* Loads a variable, from its frame slot if it was given one */
+static void compile_load_name(ana_vm *vm, ana_function_defn *func, char *name,
+  int flag, node *ast)
+{
+  int slot = ana_function_defn_getlocal(func, name);
+
+  if(slot != -1)
+    EMITX(vm, func, LOAD_FAST, slot, flag, ast);
+  else
+    EMITX(vm, func, LOAD_NAME, NEW_SYMBOL(vm, name), flag, ast);
+}
+
+static void compile_store_name(ana_vm *vm, ana_function_defn *func, char *name,
+  int flag, node *ast)
+{
+  int slot = ana_function_defn_getlocal(func, name);
+
+  if(slot != -1)
+    EMITX(vm, func, STORE_FAST, slot, flag, ast);
+  else
+    EMITX(vm, func, STORE_NAME, NEW_SYMBOL(vm, name), flag, ast);
+}
+
+/* How many values an instruction takes off the stack, and puts back */
+static void stack_effect(ana_uint32_t instruction, int *pops, int *pushes)
+{
+  int opcode = (int)(instruction >> 24);
+  int arg = (int)(short)((instruction >> 8) & 0xffff);
+  int flag = (int)(instruction & 0xff);
+
+  *pops = 0;
+  *pushes = 0;
+
+  switch(opcode)
+  {
+    case LOAD_CONST: case LOAD_NAME: case LOAD_FAST:
+      *pushes = 1;
+      break;
+    case STORE_NAME: case STORE_FAST: case SETPROP:
+      *pops = opcode == SETPROP ? 2 : 1;
+      *pushes = !flag;
+      break;
+    case IDIV: case IADD: case ILTE: case ITIMES: case IMINUS: case IEQUAL:
+    case INEQUAL: case IREM: case IIN: case ILSHFT: case IRSHFT: case IGTE:
+    case IGT: case ILT: case ILAND: case ILOR: case LOAD_SUBSCRIPT:
+    case IADD_LL: case IMINUS_LL: case ITIMES_LL: case IDIV_LL: case IREM_LL:
+    case ILT_LL: case IGT_LL: case ILTE_LL: case IGTE_LL: case IADD_DD:
+    case IMINUS_DD: case ITIMES_DD: case IDIV_DD:
+      *pops = 2;
+      *pushes = 1;
+      break;
+    case IUNARYMINUS: case IUNARYPLUS: case IUNARYNOT: case GETPROP:
+    case ITER: case IIMPORT:
+      *pops = 1;
+      *pushes = 1;
+      break;
+    case ITHROW: case JMPZ:
+      *pops = 1;
+      break;
+    case STORE_SUBSCRIPT:
+      *pops = 3;
+      *pushes = !flag;
+      break;
+    case INITARRAY:
+      *pops = arg;
+      *pushes = 1;
+      break;
+    case INITOBJ:
+      *pops = arg * 2;
+      *pushes = 1;
+      break;
+    case LOAD_METHOD:
+      *pops = 1;
+      *pushes = 2;
+      break;
+    case CALL: case TAILCALL:
+      *pops = arg + 1;
+      *pushes = 1;
+      break;
+    case CALL_METHOD:
+      *pops = arg + 2;
+      *pushes = 1;
+      break;
+    case DEFINE_FUNCTION:
+      *pops = 2;
+      break;
+    /* the method count is only known when it runs, leaving the methods
+       counted on the stack overestimates, which is safe */
+    case DEFINE_CLASS:
+      *pops = 2 + !!flag;
+      break;
+  }
+}
+
+/*
+ * Walks every path through the code keeping the stack depth, so frames
+ * can be handed a stack exactly as deep as they need. Loops unwind to
+ * the depth they began at, and a try handler starts at the depth the
+ * try began at, which is recorded in the exception table
+ */
+static void compute_max_stack(ana_function_defn *func)
+{
+  ana_size_t size = func->code_size;
+  ana_size_t i;
+  long *depth = malloc(sizeof(long) * (size + 1));
+  ana_size_t *loop_begin = malloc(sizeof(ana_size_t) * (size + 1));
+  ana_size_t *work = malloc(sizeof(ana_size_t) * (size + 1));
+  ana_size_t *open = malloc(sizeof(ana_size_t) * (size + 1));
+  ana_size_t *loops = malloc(sizeof(ana_size_t) * (size + 1));
+  char *queued = calloc(size + 1, 1);
+  ana_size_t nwork = 0, nopen = 0;
+  long limit = (long)size * 2 + 2;
+  long max = 0;
+
+  for(i = 0; i < size; i++)
+  {
+    int opcode = (int)(func->code[i] >> 24);
+
+    depth[i] = -1;
+    loop_begin[i] = 0;
+    loops[i] = nopen;
+
+    if(opcode == BEGIN_LOOP)
+      open[nopen++] = i;
+    else if(opcode == EXIT_LOOP_CONTINUE && nopen > 0)
+      loop_begin[i] = open[nopen - 1];
+    else if(opcode == END_LOOP && nopen > 0)
+      loop_begin[i] = open[--nopen];
+  }
+
+#define STACK_FLOW(to, d) do { \
+  ana_size_t _to = (to); \
+  long _d = (d) < 0 ? 0 : (d); \
+  if(_to < size && _d > depth[_to] && _d <= limit) \
+  { \
+    depth[_to] = _d; \
+    if(!queued[_to]) \
+    { \
+      queued[_to] = 1; \
+      work[nwork++] = _to; \
+    } \
+  } \
+} while(0)
+
+  if(size > 0)
+  {
+    depth[0] = 0;
+    queued[0] = 1;
+    work[nwork++] = 0;
+  }
+
+  while(nwork > 0)
+  {
+    ana_size_t pc = work[--nwork];
+    ana_uint32_t instruction = func->code[pc];
+    int opcode = (int)(instruction >> 24);
+    int arg = (int)(short)((instruction >> 8) & 0xffff);
+    long in = depth[pc];
+    long out;
+    int pops, pushes;
+
+    queued[pc] = 0;
+
+    stack_effect(instruction, &pops, &pushes);
+
+    out = in - pops;
+    if(out < 0)
+      out = 0;
+    out += pushes;
+
+    if(in > max)
+      max = in;
+    if(out > max)
+      max = out;
+
+    for(i = 0; i < func->nhandlers; i++)
+    {
+      if(func->handlers[i].start == pc)
+        STACK_FLOW(func->handlers[i].handler, in);
+    }
+
+    switch(opcode)
+    {
+      case JMP:
+        STACK_FLOW(func->jump_table[arg], in);
+        break;
+      case JMPZ:
+        STACK_FLOW(func->jump_table[arg], out);
+        STACK_FLOW(pc + 1, out);
+        break;
+      case JMPF: case JMPT:
+        STACK_FLOW(func->jump_table[arg], in);
+        STACK_FLOW(pc + 1, in);
+        break;
+      case ITER_MV:
+        STACK_FLOW(func->jump_table[arg], in - 1);
+        STACK_FLOW(pc + 1, in + 1);
+        if(in + 1 > max)
+          max = in + 1;
+        break;
+      case EXIT_LOOP_CONTINUE:
+        STACK_FLOW(pc + 1, depth[loop_begin[pc]]);
+        break;
+      case END_LOOP:
+        out = depth[loop_begin[pc]];
+        STACK_FLOW(pc + 1, in < out ? in : out);
+        break;
+      case IRETURN:
+        break;
+      default:
+        STACK_FLOW(pc + 1, out);
+        break;
+    }
+  }
+
+#undef STACK_FLOW
+
+  func->max_stack = (ana_size_t)max;
+
+  for(i = 0; i < func->nhandlers; i++)
+  {
+    ana_size_t start = func->handlers[i].start;
+
+    func->handlers[i].sp = depth[start] > 0 ? (ana_uint32_t)depth[start] : 0;
+    func->handlers[i].loop_depth = (ana_uint32_t)loops[start];
+  }
+
+  free(depth);
+  free(loop_begin);
+  free(work);
+  free(open);
+  free(loops);
+  free(queued);
+}
+
+/* Seals a function once all of its code has been emitted */
+static void finalize_function(ana_function_defn *func)
+{
+  ana_function_defn_finalize(func);
+  compute_max_stack(func);
+}
+
 static void compile_func(ana_vm *vm, ana_object *parentfuncobj, node *ast)
 {
   ana_function_defn *parentfunc = ANA_GET_FUNCTION_DEF(parentfuncobj);
@@ -122,6 +480,8 @@ static void compile_func(ana_vm *vm, ana_object *parentfuncobj, node *ast)
     ana_array_push(func->parameters, ana_stringfromstring(id_node->value));
   }
 
+  compile_locals(func, body, 0);
+
   ana_compile_unit(vm, funcobj, body);
 
   if(body->nchild > 0) 
@@ -136,6 +496,8 @@ static void compile_func(ana_vm *vm, ana_object *parentfuncobj, node *ast)
     ana_compile_return_statement(vm, func); 
   }
 
+  finalize_function(func);
+
   /* put this object in the constant table */
 
   EMITX(vm, parentfunc, LOAD_CONST, NEW_FUNCTION_CONST(vm, funcobj), 0, ast);
@@ -195,6 +557,8 @@ static void compile_class(ana_vm *vm, ana_object *parentfuncobj, node *ast)
 
       ana_array_push(func->parameters, ana_stringfromstring(idnode->value));
     }
+
+    compile_locals(func, body, 1);
     
     ana_compile_unit(vm, funcobj, body);
 
@@ -210,6 +574,8 @@ static void compile_class(ana_vm *vm, ana_object *parentfuncobj, node *ast)
       ana_compile_return_statement(vm, func); 
     }
 
+    finalize_function(func);
+
     EMITX(vm, parentfunc, LOAD_CONST, NEW_FUNCTION_CONST(vm, funcobj), 0, ast);
     EMITX(vm, parentfunc, LOAD_CONST, NEW_STR_CONST(vm, name->value), 0,  ast);
   }
@@ -240,21 +606,20 @@ static void compile_try(ana_vm *vm, ana_object *parentfuncobj, node *stmt)
   node *exceptionvar = stmt->children[1];
   node *catchbody = stmt->children[2];
 
-  /* place holder */
-  ana_array_push(parentfunc->jump_targets, NULL);
-  int jmptargetindex_exhandler = ana_array_size(parentfunc->jump_targets) - 1;
-  
   ana_array_push(parentfunc->jump_targets, NULL);
   int jmptargetindex_skipexhandler = ana_array_size(parentfunc->jump_targets) - 1;
 
-  EMITX(vm, parentfunc, TRY, jmptargetindex_exhandler, 0, trybody);
+  /* nothing is emitted to enter the try, the range goes in the table */
+  ana_size_t start = parentfunc->code_size;
   
   ana_compile_unit(vm, parentfuncobj, trybody);
+
+  ana_size_t end = parentfunc->code_size;
   
   EMITX(vm, parentfunc, JMP, jmptargetindex_skipexhandler, 0, catchbody);
-  
-  ana_array_push_index(parentfunc->jump_targets, jmptargetindex_exhandler,
-    ana_longfromlong((long)parentfunc->code_size));
+
+  ana_function_defn_addhandler(parentfunc, start, end, 
+    parentfunc->code_size);
 
   assert(exceptionvar->kind == COMO_AST_ID);
   
@@ -353,7 +718,7 @@ static void compile_compound_if(ana_vm *vm, ana_object *funcobj,
   else
   {
     ana_array_push_index(func->jump_targets,
-      exit_address, ana_longfromlong(ana_get_long(else_addr)->value));     
+      exit_address, ana_longfromlong(ana_long_value(else_addr)));     
   }
 
   if(!(ana_array_size(jmp_map) == ana_array_size(jmp_targets)))
@@ -373,7 +738,7 @@ static void compile_compound_if(ana_vm *vm, ana_object *funcobj,
 
   ana_array_foreach(jmp_map, index, value) {
     (void)index;
-    long jmp_target_index = ana_get_long(value)->value;
+    long jmp_target_index = ana_long_value(value);
 
     ana_get_array(func->jump_targets)->items[jmp_target_index] =
       ana_get_array(jmp_targets)->items[--current_index];
@@ -468,6 +833,10 @@ static void compile_while(ana_vm *vm, ana_object *funcobj, node *ast)
   ana_compile_unit_ex(vm, funcobj, body, 
     &break_address_index, &continue_address_index);
 
+  /* continue drops what the body left on the stack, then re-evaluates */
+  ana_array_push_index(func->jump_targets, continue_address_index,
+    ana_longfromlong((long)func->code_size));
+
   EMITX(vm, func, EXIT_LOOP_CONTINUE, 0, 0, body);
   
   EMITX(vm, func, JMP, jmptargetindex_start, 0, body);
@@ -481,10 +850,6 @@ static void compile_while(ana_vm *vm, ana_object *funcobj, node *ast)
 
   ana_array_push_index(func->jump_targets, break_address_index,
     ana_longfromlong((long)end));
-
-  ana_array_push_index(func->jump_targets, continue_address_index,
-    ana_longfromlong((long)jmptargetindex_start));
-
 }
 
 static void compile_for(ana_vm *vm, ana_object *funcobj, node *ast)
@@ -567,7 +932,7 @@ static void compile_foreach(ana_vm *vm, ana_object *funcobj, node *ast)
   EMITX(vm, func, BEGIN_LOOP, 0, 0, iterable);
   int start_address = DEFINE_JUMP();
   EMITX(vm, func, ITER_MV,    exit_address, 0, iterable);
-  EMITX(vm, func, STORE_NAME, NEW_SYMBOL(vm, id), 0, 
+  compile_store_name(vm, func, id, 0, 
     ast->children[0]);
 
   ana_compile_unit(vm, funcobj, statements);
@@ -821,8 +1186,11 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
 
       if(callable_expression->kind == COMO_AST_PROP)
       {
+        char *id = ((node_id *)callable_expression->children[1])->value;
+
+        /* pushes the receiver and the unbound method */
         ana_compile_unit(vm, funcobj, callable_expression->children[0]);
-        ana_compile_unit(vm, funcobj, callable_expression);   
+        EMITX(vm, func, LOAD_METHOD, NEW_SYMBOL(vm, id), 0, callable_expression);
         EMITX(vm, func, CALL_METHOD, args->nchild, callflags, callable_expression);
       } 
       else 
@@ -856,6 +1224,16 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
 
       if(retvalused) {
         ana_compile_unit(vm, funcobj, ast->children[0]);
+
+        /* return f(...) runs f in this frame, the IRETURN stays for when 
+           it can't */
+        if(func->code_size > 0 
+            && (func->code[func->code_size - 1] >> 24) == CALL)
+        {
+          func->code[func->code_size - 1] = PACK_INSTRUCTION(TAILCALL,
+            (func->code[func->code_size - 1] >> 8) & 0xffff, 
+            func->code[func->code_size - 1] & 0xff);
+        }
       }
       else
         EMITX(vm, func, LOAD_CONST, NEW_INT_CONST(vm, 0), 0, ast);
@@ -865,7 +1243,7 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
     }
     TARGET(COMO_AST_ID) {
       char *id = ((node_id *)ast)->value;
-      EMITX(vm, func, LOAD_NAME, NEW_SYMBOL(vm, id), 0, ast);
+      compile_load_name(vm, func, id, 0, ast);
       break;
     }
     TARGET(COMO_AST_STRING) {
@@ -1020,7 +1398,7 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
             node_id *name = (node_id *)ast->children[0];
             ana_compile_unit(vm, funcobj, ast->children[1]);
 
-            EMITX(vm, func, STORE_NAME, NEW_SYMBOL(vm, name->value), 0, ast);
+            compile_store_name(vm, func, name->value, 0, ast);
           }
           break;
         }
@@ -1031,7 +1409,7 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
           ana_compile_unit(vm, funcobj, ast->children[0]);
           ana_compile_unit(vm, funcobj, ast->children[1]);
           EMITX(vm, func, IADD, 0, 0, ast);
-          EMITX(vm, func, STORE_NAME, NEW_SYMBOL(vm, name->value), 0, ast);
+          compile_store_name(vm, func, name->value, 0, ast);
           break;
         }
         TARGET(COMO_AST_MUL) {
@@ -1084,11 +1462,11 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
 
         node_id *name = (node_id *)left;
 
-        EMITX(vm, func, LOAD_NAME,  NEW_SYMBOL(vm, name->value), 1, left);
-        EMITX(vm, func, LOAD_NAME,  NEW_SYMBOL(vm, name->value), 1, left);
+        compile_load_name(vm, func, name->value, 1, left);
+        compile_load_name(vm, func, name->value, 1, left);
         EMITX(vm, func, LOAD_CONST, NEW_INT_CONST(vm, 1), 1, left);
         EMITX(vm, func, IADD,     0,                    0, left);
-        EMITX(vm, func, STORE_NAME, NEW_SYMBOL(vm, name->value), 0, left);
+        compile_store_name(vm, func, name->value, 0, left);
       }
 
       break;
@@ -1133,10 +1511,10 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
         
         node_id *name = (node_id *)left;
 
-        EMITX(vm, func, LOAD_NAME,  NEW_SYMBOL(vm, name->value), 1, left);
+        compile_load_name(vm, func, name->value, 1, left);
         EMITX(vm, func, LOAD_CONST, NEW_INT_CONST(vm, 1), 1, left);
         EMITX(vm, func, IMINUS,     0,                    0, left);
-        EMITX(vm, func, STORE_NAME, NEW_SYMBOL(vm, name->value), 0, left);
+        compile_store_name(vm, func, name->value, 0, left);
       }
 
       break;    
@@ -1192,11 +1570,11 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
 
         node_id *name = (node_id *)left;
 
-        EMITX(vm, func, LOAD_NAME,  NEW_SYMBOL(vm, name->value), 1, left);
-        EMITX(vm, func, LOAD_NAME,  NEW_SYMBOL(vm, name->value), 1, left);
+        compile_load_name(vm, func, name->value, 1, left);
+        compile_load_name(vm, func, name->value, 1, left);
         EMITX(vm, func, LOAD_CONST, NEW_INT_CONST(vm, 1), 1, left);
         EMITX(vm, func, IADD,       0,                    0, left);
-        EMITX(vm, func, STORE_NAME, NEW_SYMBOL(vm, name->value), 1, left);
+        compile_store_name(vm, func, name->value, 1, left);
       }
 
       break;
@@ -1253,12 +1631,12 @@ static void ana_compile_unit_ex(ana_vm *vm, ana_object *funcobj,
         node_id *name = (node_id *)left;
 
         /* Store the value before it was decremented */
-        EMITX(vm, func, LOAD_NAME,  NEW_SYMBOL(vm, name->value), 1, left);
-        EMITX(vm, func, LOAD_NAME,  NEW_SYMBOL(vm, name->value), 1, left);
+        compile_load_name(vm, func, name->value, 1, left);
+        compile_load_name(vm, func, name->value, 1, left);
         EMITX(vm, func, LOAD_CONST, NEW_INT_CONST(vm, 1), 1, left);
         EMITX(vm, func, IMINUS,     0,                    0, left);
         /* pass 1 to oparg, to tell it not to push this value to the stack */
-        EMITX(vm, func, STORE_NAME, NEW_SYMBOL(vm, name->value), 1, left);
+        compile_store_name(vm, func, name->value, 1, left);
       }
 
       break;    
@@ -1321,6 +1699,8 @@ ana_function *ana_compileast(ana_vm *vm, ana_compile_state *state)
   ana_compile_unit(vm, func, state->ast);
 
   ana_compile_return_statement(vm, ANA_GET_FUNCTION_DEF(func));
+
+  finalize_function(ANA_GET_FUNCTION_DEF(func));
   
   return ana_get_function(func);
 }
@@ -1335,6 +1715,8 @@ ana_module *ana_compilemodule(ana_vm *vm, ana_compile_state *state, char *modnam
 
   ana_compile_return_statement(vm, ANA_GET_FUNCTION_DEF(func));	
 
+  finalize_function(ANA_GET_FUNCTION_DEF(func));
+
   ana_module *module = (ana_module *)ana_module_new(modname, func);	
 
   return module;	
@@ -37,6 +37,7 @@
 
 #define LIKELY(x)       __builtin_expect(!!(x), 1)
 #define UNLIKELY(x)     __builtin_expect(!!(x), 0)
+#define PREFETCH(addr)  __builtin_prefetch((addr))
 
 
 COMO_OBJECT_API char *ana_get_fn_name(ana_frame * frame);
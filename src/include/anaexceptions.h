@@ -8,15 +8,22 @@
 #define InvalidOperation "InvalidOperation"
 #define AnaNameError     "NameError"
 
+#define ANA_EXCEPTION_MESSAGE_MAX 1024
+
 extern char **ana__excep_location(void);
 extern char **ana__except_type_location(void);
 
-#define ana_excep (*ana__excep_location())
-#define ana_except_type (*ana__except_type_location())
+/* Checked after every instruction, so they're read directly */
+extern char *ana__excep;
+extern char *ana__except_type;
+
+#define ana_excep ana__excep
+#define ana_except_type ana__except_type
+
+/* The message is formatted into storage that's reused by the next error */
+extern void ana__set_error(const char *type, const char *fmt, ...);
 
-#define Ana_SetError(type, fmt, ...) do { \
-  ana_except_type = (type); \
-  ana_excep = ana_build_str(fmt,  ##__VA_ARGS__); \
-} while(0)
+#define Ana_SetError(type, fmt, ...) \
+  ana__set_error((type), fmt, ##__VA_ARGS__)
 
 #endif
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #define COMO_OBJECT_API __attribute__((__visibility__("default")))
 
+#include <stdint.h>
+
 /* We're modeling the object system with all of C's operators */
 typedef struct _ana_type   ana_type;
 typedef struct _ana_object ana_object;
@@ -79,45 +81,118 @@ struct _ana_type {
   ana_object*(*obj_iter_next)(ana_object *);
 };
 
+/* Integers that fit in 62 bits are stored in the pointer itself, tagged
+ * with 01 in the low two bits, and most doubles are stored as flonums
+ * tagged with 10 (see double.h). Immediates are never allocated, tracked
+ * or freed, and report ana_long_type or ana_double_type as their type.
+ */
+#define ANA_IMMEDIATE_MASK 3
+#define ANA_SMALL_TAG      1
+#define ANA_FLONUM_TAG     2
+#define ANA_SMALL_MAX      ((long)(((unsigned long)1 << 61) - 1))
+#define ANA_SMALL_MIN      (-ANA_SMALL_MAX - 1)
+
+#define ana_is_immediate(o) \
+  (((uintptr_t)(o) & ANA_IMMEDIATE_MASK) != 0)
+
+#define ana_is_small(o) \
+  (((uintptr_t)(o) & ANA_IMMEDIATE_MASK) == ANA_SMALL_TAG)
+
+#define ana_is_flonum(o) \
+  (((uintptr_t)(o) & ANA_IMMEDIATE_MASK) == ANA_FLONUM_TAG)
+
+#define ana_small_fits(v) \
+  ((v) >= ANA_SMALL_MIN && (v) <= ANA_SMALL_MAX)
+
+#define ana_small_value(o) \
+  ((long)((intptr_t)(o) >> 2))
+
+#define ana_small_from(v) \
+  ((ana_object *)(((uintptr_t)(long)(v) << 2) | ANA_SMALL_TAG))
+
+extern ana_type ana_long_type;
+extern ana_type ana_double_type;
+
+static inline ana_type *ana_type_of(ana_object *o)
+{
+  if(!ana_is_immediate(o))
+    return o->type;
+
+  return ana_is_small(o) ? &ana_long_type : &ana_double_type;
+}
+
+/* Immortal objects are owned by the runtime, they are shared by every
+ * user, never tracked by the GC, never refcounted and never destroyed.
+ */
+#define ANA_OBJECT_IMMORTAL (-1)
+
+#define ana_is_immortal(o) \
+  (ana_is_immediate(o) \
+    || ((ana_object *)(o))->is_tracked == ANA_OBJECT_IMMORTAL)
+
+#define ana_make_immortal(o) \
+  (((ana_object *)(o))->is_tracked = ANA_OBJECT_IMMORTAL)
+
+#define ana_incref(o) do { \
+  if(!ana_is_immortal(o)) \
+    ((ana_object *)(o))->refcount++; \
+} while(0)
+
+#define ana_decref(o) do { \
+  if(!ana_is_immortal(o)) \
+    ((ana_object *)(o))->refcount--; \
+} while(0)
+
+/* Drops a reference held by a variable. Never goes below zero, values 
+   left on the stack when a frame exits are released without having been
+   counted */
+static inline void ana_release(ana_object *o)
+{
+  if(!ana_is_immortal(o) && o->refcount > 0)
+    o->refcount--;
+}
+
 #define ana_object_init(x) ana_object_ctor(x)
 
 #define ana_object_finalize(o) \
-  (((ana_object *)(o))->type->obj_deinit((ana_object *)(o)))
+  (ana_type_of((ana_object *)(o))->obj_deinit((ana_object *)(o)))
 
 #define ana_object_ctor(o) \
-  (((ana_object *)(o))->type->obj_init((ana_object *)(o)))
+  (ana_type_of((ana_object *)(o))->obj_init((ana_object *)(o)))
 
 #define ana_object_equals(o, b) \
-  (((ana_object *)(o))->type->obj_equals((ana_object *)(o), (ana_object *)(b)))
+  (ana_type_of((ana_object *)(o))->obj_equals((ana_object *)(o), \
+    (ana_object *)(b)))
 
 #define ana_type_is(ob, tp) \
-  (((ana_object *)(ob))->type == &tp)
+  (ana_type_of((ana_object *)(ob)) == &tp)
 
 #define ana_type_check_both(left, right, type) \
   (ana_type_is((left), (type)) && ana_type_is((right), (type)))
 
 #define ana_type_name(o) \
-  (((ana_object *)(o))->type->obj_name)
+  (ana_type_of((ana_object *)(o))->obj_name)
 
 #define ana_object_print(o) do { \
-  assert(((ana_object *)((o)))->type->obj_print != NULL); \
-  (((ana_object *)((o)))->type->obj_print((ana_object *)((o)))); \
+  assert(ana_type_of((ana_object *)((o)))->obj_print != NULL); \
+  (ana_type_of((ana_object *)((o)))->obj_print((ana_object *)((o)))); \
 } while(0)
 
 #define ana_object_tostring(o) \
-  (((ana_object *)(o))->type->obj_str((ana_object *)(o)))
+  (ana_type_of((ana_object *)(o))->obj_str((ana_object *)(o)))
 
 #define ana_object_to_cstring(o) \
-  (((ana_object *)(o))->type->obj_str((ana_object *)(o)))
+  (ana_type_of((ana_object *)(o))->obj_str((ana_object *)(o)))
 
 #define ana_object_dtor(o) \
-  (((ana_object *)(o))->type->obj_dtor((ana_object *)(o)));
+  (ana_is_immortal(o) ? (void)0 \
+    : ((ana_object *)(o))->type->obj_dtor((ana_object *)(o)));
 
 #define ana_get_base(o) \
   (((ana_object *)(o)))
 
 #define ana_tostring_fast(obj, block) do { \
-  assert(((ana_object *)(obj))->type->obj_str != NULL); \
+  assert(ana_type_of((ana_object *)(obj))->obj_str != NULL); \
   ana_object *_value = ana_object_tostring((obj)); \
   char *value = ana_cstring(_value); \
   block \
@@ -11,6 +11,7 @@ typedef struct _ana_array
   ana_size_t size;
   ana_size_t capacity;
   ana_object **items;
+  ana_size_t dirty;     /* lowest index written since the collector looked */
 } ana_array;
 
 
@@ -34,6 +35,11 @@ COMO_OBJECT_API void ana_array_type_init(ana_vm *vm);
 COMO_OBJECT_API void ana_array_type_finalize(ana_vm *vm);
 
 #define ana_get_array(o) ((ana_array *)(o))
+
+#define ana_array_touch(self, i) do { \
+  if((i) < (self)->dirty) \
+    (self)->dirty = (i); \
+} while(0)
 #define ana_array_size(o) (ana_get_array((o))->size)
 
 #define ana_array_foreach(_array, indexname, valuename) { \
@@ -1,9 +1,9 @@
 #ifndef COMO_BUILTIN
 #define COMO_BUILTIN
 
-ana_object *ana__builtin_readline(ana_object *args);
-ana_object *ana__builtin_print(ana_object *args);
-ana_object *ana__builtin_int(ana_object *args);
-ana_object *ana__builtin_typeof(ana_object *args);
+ana_object *ana__builtin_readline(ana_object *self, ana_object **argv, int argc);
+ana_object *ana__builtin_print(ana_object *self, ana_object **argv, int argc);
+ana_object *ana__builtin_int(ana_object *self, ana_object **argv, int argc);
+ana_object *ana__builtin_typeof(ana_object *self, ana_object **argv, int argc);
 
 #endif
\ No newline at end of file
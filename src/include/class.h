@@ -5,19 +5,38 @@
 #   error "Please do not include class.h directly"
 #endif
 
+/* 
+ * The layout shared by every instance of a class that was given the same
+ * properties in the same order. Adding a property moves an instance to a 
+ * child of its shape, so the shapes of a class form a transition tree 
+ * rooted at the empty shape.
+ */
+typedef struct _ana_shape {
+  struct _ana_shape  *parent;
+  ana_object         *name;        /* property this shape added */
+  ana_object         *slots;       /* name to slot index, for every property */
+  ana_size_t          nslots;
+  struct _ana_shape **transitions;
+  ana_size_t          ntransitions;
+  ana_size_t          transitions_capacity;
+} ana_shape;
+
 typedef struct _ana_class
 {
   ana_object base;
   ana_object *c_base;
   ana_object *name;
   ana_object *members;
+  ana_shape *root_shape;
 } ana_class;
 
 typedef struct _ana_instance {
   ana_object base;
   ana_object *base_instance; /* an ana_instance type */
   ana_class *self;           /* pointer to the class of this instance */
-  ana_object *properties;    /* map of instance specific properties */
+  ana_shape *shape;          /* names of the instance specific properties */
+  ana_object **values;       /* their values, indexed by slot */
+  ana_size_t capacity;
   ana_module *module;
 } ana_instance;
 
@@ -26,6 +45,28 @@ COMO_OBJECT_API ana_object *ana_class_new(ana_object *base,
 
 COMO_OBJECT_API ana_object *ana_instance_new(ana_object *class_defn);
 
+COMO_OBJECT_API ana_object *ana_instance_get_property(ana_instance *ins,
+  ana_object *name);
+
+COMO_OBJECT_API ana_object *ana_instance_set_property(ana_instance *ins,
+  ana_object *name, ana_object *value);
+
+COMO_OBJECT_API void ana_instance_set_shape(ana_instance *ins, 
+  ana_shape *shape);
+
+/* The slot of name in the shape, or -1 when the shape doesn't have it */
+COMO_OBJECT_API long ana_shape_slot(ana_shape *shape, ana_object *name);
+
+#define ana_instance_foreach(_ins, valuename) { \
+  ana_instance *_instance = ana_get_instance(_ins); \
+  ana_size_t _slot; \
+  for(_slot = 0; _slot < _instance->shape->nslots; _slot++) { \
+    ana_object *valuename = _instance->values[_slot]; \
+
+#define ana_instance_foreach_end() \
+  } \
+} \
+
 #define ana_get_class(o) ((ana_class *)(o))
 #define ana_get_instance(o) ((ana_instance *)(o))
 
@@ -1,6 +1,9 @@
 #ifndef COMO_DOUBLE_OBJECT_H
 #define COMO_DOUBLE_OBJECT_H
 
+#include <stdint.h>
+#include <string.h>
+
 # if !(defined(COMO_BASE_INCLUDED))
 #   error "Please do not include double.h directly"
 #endif
@@ -12,8 +15,69 @@ typedef struct _ana_double {
 
 extern ana_type ana_double_type;
 
+/* Only valid for boxed doubles, use ana_double_value for any double */
 #define ana_get_double(o) ((ana_double *)(o))
 
+/* A flonum keeps the double's bits rotated left by 3, with the tag in
+ * the two low bits. That drops the two high exponent bits, so only
+ * doubles whose top exponent bits are 011 or 100 (magnitudes from about
+ * 1e-77 to 1e77) and +0.0 fit, everything else is boxed. +0.0 takes the
+ * encoding of 1.72723e-77, which is boxed instead.
+ */
+#define ANA_FLONUM_ZERO   (((uint64_t)1 << 63) | ANA_FLONUM_TAG)
+#define ANA_FLONUM_STOLEN ((uint64_t)0x3000000000000000)
+
+static inline int ana_flonum_fits(double d)
+{
+  uint64_t bits;
+  int top;
+
+  memcpy(&bits, &d, sizeof(bits));
+
+  top = (int)((bits >> 60) & 0x7);
+
+  return sizeof(ana_object *) == sizeof(uint64_t) 
+    && (bits == 0 || ((top == 3 || top == 4) && bits != ANA_FLONUM_STOLEN));
+}
+
+static inline ana_object *ana_flonum_from(double d)
+{
+  uint64_t bits;
+
+  memcpy(&bits, &d, sizeof(bits));
+
+  if(bits == 0)
+    return (ana_object *)(uintptr_t)ANA_FLONUM_ZERO;
+
+  bits = (bits << 3) | (bits >> 61);
+
+  return (ana_object *)(uintptr_t)((bits & ~(uint64_t)ANA_IMMEDIATE_MASK) 
+    | ANA_FLONUM_TAG);
+}
+
+static inline double ana_flonum_value(ana_object *o)
+{
+  uint64_t bits = (uint64_t)(uintptr_t)o;
+  double d;
+
+  if(bits == ANA_FLONUM_ZERO)
+  {
+    bits = 0;
+  }
+  else
+  {
+    bits = (2 - (bits >> 63)) | (bits & ~(uint64_t)ANA_IMMEDIATE_MASK);
+    bits = (bits >> 3) | (bits << 61);
+  }
+
+  memcpy(&d, &bits, sizeof(d));
+
+  return d;
+}
+
+#define ana_double_value(o) \
+  (ana_is_flonum(o) ? ana_flonum_value(o) : ana_get_double(o)->value)
+
 COMO_OBJECT_API ana_object *ana_doublefromdouble(double dval);
 
 #endif
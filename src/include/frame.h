@@ -5,23 +5,7 @@
 #   error "Please do not include class.h directly"
 #endif
 
-/* Internal use only */
-typedef struct _ana_basic_block {
-  union {
-    int jmpto;
-    int stack_obj_count;
-  };
-  struct _ana_basic_block *next;
-} ana_basic_block;
-
-typedef struct ana_generic_block
-{
-  ana_basic_block **stack;
-  ana_basic_block  *root;
-  ana_size_t        stack_size;
-  ana_size_t        stack_capacity;
-  ana_size_t        stack_position;
-} ana_generic_block;
+#define COMO_BLOCK_STACK_MAX      16
 
 typedef struct _ana_frame ana_frame;
 
@@ -31,35 +15,35 @@ struct _ana_frame {
   ana_size_t flags;
   unsigned int *code;           /* this is not allocated or deallocated here, it's provided by a function defn */
   ana_size_t  code_size;
-  ana_size_t  current_line;     /* Current line of code being executed */
+  struct _ana_function_def *defn; /* the definition the code belongs to */
   ana_size_t  pc;               /* current index into the code array, reset to 0 at EOO (end of execution) */
-  ana_object **stack;           /* this is dynamically allocated */
-  ana_size_t sz;                /* keeps its size across reuse */
+  ana_object **stack;           /* window of the vm value stack */
+  ana_size_t sz;                /* size of the window */
   ana_size_t sp;                /* always reset to 0, at EOO */
   ana_object *locals;           /* hash map of names to values */
+  ana_object **fastlocals;      /* slot indexed locals, see defn->local_names */
+  ana_size_t nlocals;
   ana_object *globals;          /* global variables */
   ana_object          *self;    /* the current object */
-  ana_generic_block  *loop;     
-  ana_generic_block  *exception;
-  ana_object         *jump_targets;
+  ana_size_t loop_sp[COMO_BLOCK_STACK_MAX]; /* stack depth at each BEGIN_LOOP */
+  ana_size_t loop_depth;        /* number of loops being executed */
+  ana_uint32_t       *jump_table; /* provided by the function defn */
   ana_object *name;             /* the name of the function being executed */
-  ana_size_t  activation_line_number;
-  ana_object *line_mapping;
   ana_object *filename;
   ana_frame  *caller;
   ana_object *retval;
   ana_module *module;
+  struct ana_vm *vm;            /* owner of the value stack */
+  ana_size_t slots;             /* capacity of slot_storage */
+  ana_object *slot_storage[];   /* fastlocals, allocated with the frame */
 };
 
 ana_frame *ana_frame_new(
-  unsigned int *code, 
-  ana_size_t code_size,
-  ana_object   *jumptargets, 
-  ana_object   *line_mapping, 
+  struct ana_vm *vm,
+  struct _ana_function_def *defn,
   ana_object   *global_variables, 
   ana_object   *name, 
   ana_frame    *caller, 
-  int line, 
   ana_object   *filename
 );
 
@@ -67,18 +51,22 @@ ana_frame *ana_frame_new(
 
 extern ana_type ana_frame_type;
 
-COMO_OBJECT_API ana_basic_block *ana_basic_block_new(int targetaddress);
+COMO_OBJECT_API void ana_frame_type_finalize(struct ana_vm *vm);
 
-COMO_OBJECT_API void ana_frame_growstack(ana_object *);
+COMO_OBJECT_API int ana_frame_getline(ana_frame *frame);
 
 #define COMO_FRAME_STACK_SIZE     8
 #define COMO_FRAME_CONSTANTS_SIZE 8
 #define COMO_FRAME_LOCALS_SIZE    8
 #define COMO_FRAME_MAX_OBJECTS    16
 #define COMO_PARAMS_SIZE          4
-#define COMO_BLOCK_STACK_MAX      16
 #define COMO_FRAME_DEFN           (1 << 0)
 #define COMO_FRAME_EXEC           (1 << 1)
 #define COMO_FRAME_MODULE         (1 << 2)
+#define COMO_FRAME_OWNS_STACK     (1 << 3)
+
+/* A base constructor returns its instance into the child constructor 
+   frame before it starts running, the one value the compiler can't see */
+#define COMO_FRAME_STACK_SLACK    1
 
 #endif
\ No newline at end of file
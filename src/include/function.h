@@ -13,10 +13,65 @@
 #define COMO_FUNCTION_NATIVE_METHOD \
     (COMO_FUNCTION_NATIVE | COMO_FUNCTION_METHOD)
 
-typedef ana_object*(*ana_function_handler)(ana_object *);
-typedef ana_object*(*ana_method_handler)(ana_object *, ana_object *);
+/* Natives take their arguments in order, straight off the caller's stack.
+   self is the receiver for methods and NULL for plain functions */
+typedef ana_object*(*ana_native_handler)(ana_object *self, ana_object **argv,
+  int argc);
 typedef struct ana_bounded_function ana_bounded_function;
 
+#define ANA_NAME_CHAIN_MAX 5
+
+/* 
+ * Inline cache for a LOAD_NAME site, it remembers the bucket or instance
+ * slot the name was found in and the versions of the maps searched up to
+ * and including it. The instance properties are checked by shape instead.
+ */
+typedef struct _ana_name_cache {
+  struct _ana_map_bucket *bucket;
+  struct _ana_shape *shape;  /* shape of self when it was searched */
+  long slot;                 /* slot in self, when found there */
+  ana_usize_t versions[ANA_NAME_CHAIN_MAX];
+  int depth;                 /* maps searched, 0 when the cache is empty */
+} ana_name_cache;
+
+#define ANA_PROP_CACHE_WAYS  4
+#define ANA_PROP_CACHE_DEPTH 4
+
+/* 
+ * One receiver class seen by a GETPROP, LOAD_METHOD, SETPROP or 
+ * CALL_METHOD site. owner is the number of base instance hops from the
+ * receiver to the instance the name was resolved on, and shapes are the
+ * shapes of the first nshapes instances of the chain when it was searched
+ */
+typedef struct _ana_prop_cache_entry {
+  struct _ana_class *klass;
+  struct _ana_shape *shapes[ANA_PROP_CACHE_DEPTH];
+  int nshapes;
+  int owner;
+  long slot;                     /* slot in the owner, -1 for a member */
+  ana_object *value;             /* the member, or the callable */
+  struct _ana_shape *transition; /* shape after SETPROP adds the name */
+} ana_prop_cache_entry;
+
+/* Entries are replaced round robin once all the ways are taken */
+typedef struct _ana_prop_cache {
+  ana_prop_cache_entry entries[ANA_PROP_CACHE_WAYS];
+  int count;
+  int next;
+} ana_prop_cache;
+
+/* 
+ * A try block, an exception thrown by the code in [start, end) is caught
+ * at handler with the stack and loop depth the try began at
+ */
+typedef struct _ana_exception_handler {
+  ana_uint32_t start;
+  ana_uint32_t end;
+  ana_uint32_t handler;
+  ana_uint32_t sp;
+  ana_uint32_t loop_depth;
+} ana_exception_handler;
+
 /* Represents a compile time function definition */
 typedef struct _ana_function_def {
   ana_object   base;
@@ -24,8 +79,20 @@ typedef struct _ana_function_def {
   unsigned int *code;
   ana_size_t code_size;
   ana_size_t code_capacity;
-  ana_object *line_mapping; /* code to source line mapping */
-  ana_object *jump_targets;
+  unsigned char *line_table; /* delta encoded pc to source line mapping */
+  ana_size_t line_table_size;
+  ana_size_t line_table_capacity;
+  ana_size_t line_table_pc;  /* pc and line of the last entry */
+  int        line_table_line;
+  ana_object *jump_targets;  /* boxed addresses, only used while compiling */
+  ana_uint32_t *jump_table;  /* code offsets, built by finalize */
+  ana_size_t jump_table_size;
+  ana_size_t max_stack;      /* deepest the operand stack gets */
+  ana_object *local_names;   /* names of the frame slots, parameters first */
+  ana_name_cache *name_cache; /* indexed by pc, allocated on first use */
+  ana_prop_cache **prop_cache; /* indexed by pc, each allocated on first use */
+  ana_exception_handler *handlers; /* inner try blocks come first */
+  ana_size_t nhandlers;
 } ana_function_defn;
 	
 typedef struct _ana_function 
@@ -37,10 +104,10 @@ typedef struct _ana_function
   union 
   {
     struct _ana_function_def *func;
-    ana_function_handler handler;
+    ana_native_handler handler;
     struct {
       ana_object *m_parameters;
-      ana_method_handler m_handler;
+      ana_native_handler m_handler;
     } method;
   };
 } ana_function;
@@ -54,13 +121,28 @@ struct ana_bounded_function {
 COMO_OBJECT_API ana_object *ana_function_defn_new(char *filename, char *name);
 COMO_OBJECT_API ana_object *ana_functionfromframe(ana_frame *frame);
 COMO_OBJECT_API ana_object *ana_functionfromhandler(
-  char *filename, char *name, ana_function_handler handler);
+  char *filename, char *name, ana_native_handler handler);
 
 COMO_OBJECT_API ana_object *ana_methodfromhandler(
-  char *filename, char *name, ana_method_handler handler, ana_object *parameters);
+  char *filename, char *name, ana_native_handler handler, ana_object *parameters);
 
 COMO_OBJECT_API ana_object *ana_bounded_function_new(ana_object *inst, ana_function *func);
 
+COMO_OBJECT_API void ana_function_defn_addline(ana_function_defn *defn, 
+  ana_size_t pc, int line);
+COMO_OBJECT_API int ana_function_defn_getline(ana_function_defn *defn, 
+  ana_size_t pc);
+COMO_OBJECT_API void ana_function_defn_finalize(ana_function_defn *defn);
+COMO_OBJECT_API int ana_function_defn_addlocal(ana_function_defn *defn, 
+  char *name);
+COMO_OBJECT_API int ana_function_defn_getlocal(ana_function_defn *defn, 
+  char *name);
+COMO_OBJECT_API ana_exception_handler *ana_function_defn_addhandler(
+  ana_function_defn *defn, ana_size_t start, ana_size_t end, 
+  ana_size_t handler);
+COMO_OBJECT_API ana_exception_handler *ana_function_defn_findhandler(
+  ana_function_defn *defn, ana_size_t pc);
+
 #define ana_get_function(obj) ((ana_function *)((obj)))
 #define ana_get_function_frame(obj) (((ana_function *)((obj)))->impl.frame)
 #define ana_get_function_flags(obj) (ana_get_function((obj))->flags)
@@ -15,8 +15,12 @@ COMO_OBJECT_API ana_object *ana_longfromlong(long lval);
 COMO_OBJECT_API void ana_long_type_init(ana_vm *vm);
 COMO_OBJECT_API void ana_long_type_finalize(ana_vm *vm);
 
+/* Only valid for boxed longs, use ana_long_value for any long */
 #define ana_get_long(o) ((ana_long *)(o))
 
+#define ana_long_value(o) \
+  (ana_is_small(o) ? ana_small_value(o) : ana_get_long(o)->value)
+
 extern ana_type ana_long_type;
 
 #endif
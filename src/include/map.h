@@ -18,6 +18,7 @@ typedef struct _ana_map
   ana_map_bucket **buckets;
   ana_usize_t      size;
   ana_usize_t      capacity;
+  ana_usize_t      version;  /* unique stamp, renewed when the key set changes */
 } ana_map;
 
 
@@ -35,8 +36,11 @@ COMO_OBJECT_API ana_object *ana_map_new(ana_size_t size);
 COMO_OBJECT_API ana_object *ana_map_put(ana_object *obj, ana_object *key, 
   ana_object *value);
 COMO_OBJECT_API ana_object *ana_map_get(ana_object *obj, ana_object *key);
+COMO_OBJECT_API ana_map_bucket *ana_map_get_bucket(ana_object *obj, 
+  ana_object *key);
 COMO_OBJECT_API ana_object *ana_map_delete(ana_object *obj, 
   ana_object *key);
+COMO_OBJECT_API void ana_map_clear(ana_object *obj);
 COMO_OBJECT_API void ana_map_print(ana_object *map);
 COMO_OBJECT_API ana_object *ana_get_local_ex(ana_usize_t hashed, ana_size_t len, 
   char *key, ana_map *map);
@@ -6,6 +6,178 @@
 
 #include "vmmacros.h"
 
+/* 
+ * Binds the parameter at index to value, functions compiled with slot 
+ * indexed locals keep their parameters in the first slots
+ */
+static inline void store_arg(ana_frame *execframe, ana_function_defn *call,
+  ana_size_t index, ana_object *value)
+{
+  if(execframe->fastlocals)
+    execframe->fastlocals[index] = value;
+  else
+    ana_map_put(execframe->locals, ana_array_get(call->parameters, index), 
+      value);
+}
+
+/* Drops the references a frame holds to its local variables */
+static inline void release_locals(ana_frame *frame)
+{
+  ana_size_t i;
+
+  ana_map_foreach(frame->locals, key, value) 
+  {
+    (void)key;
+
+    ana_release(value);
+  } ana_map_foreach_end();
+
+  for(i = 0; i < frame->nlocals; i++)
+  {
+    if(frame->fastlocals[i])
+      ana_release(frame->fastlocals[i]);
+  }
+}
+
+/* 
+ * The maps a name is resolved in, in order: locals, instance properties, 
+ * globals, the module of the instance and the module of the frame. The
+ * instance properties are not a map, their entry is left NULL
+ */
+static inline int name_chain(ana_frame *frame, ana_map **maps)
+{
+  int count = 0;
+
+  maps[count++] = ana_get_map(frame->locals);
+
+  if(frame->self)
+  {
+    assert(ana_type_is(frame->self, ana_instance_type));
+
+    maps[count++] = NULL;
+  }
+
+  if(frame->globals)
+    maps[count++] = ana_get_map(frame->globals);
+
+  if(frame->self && ana_get_instance(frame->self)->module)
+    maps[count++] = ana_get_map(ana_get_instance(frame->self)->module->members);
+
+  if(frame->module)
+    maps[count++] = ana_get_map(frame->module->members);
+
+  return count;
+}
+
+/* No map version is ever this, it marks the instance entry of a cache */
+#define ANA_NAME_CACHE_SELF ((ana_usize_t)-1)
+
+/* 
+ * Resolves a name through the chain, using and refilling the inline cache
+ * of the instruction. A hit needs the map the name was found in to still 
+ * have the same version, and every map before it to either have the same 
+ * version or be empty, as the locals of each call are a new map. The 
+ * instance entry hits when self still has the same shape
+ */
+static inline ana_object *lookup_name_cached(ana_frame *frame, 
+  ana_object *thename, ana_name_cache *cache)
+{
+  ana_map *maps[ANA_NAME_CHAIN_MAX];
+  int count = name_chain(frame, maps);
+  ana_shape *shape = frame->self 
+    ? ana_get_instance(frame->self)->shape : NULL;
+  int i;
+
+  if(cache->depth > 0 && cache->depth <= count)
+  {
+    for(i = 0; i < cache->depth - 1; i++)
+    {
+      if(maps[i] == NULL)
+      {
+        if(cache->versions[i] != ANA_NAME_CACHE_SELF || shape != cache->shape)
+          goto miss;
+      }
+      else if(maps[i]->version != cache->versions[i] && maps[i]->size != 0)
+      {
+        goto miss;
+      }
+    }
+
+    if(maps[i] == NULL)
+    {
+      if(cache->versions[i] != ANA_NAME_CACHE_SELF || shape != cache->shape)
+        goto miss;
+
+      return ana_get_instance(frame->self)->values[cache->slot];
+    }
+
+    if(maps[i]->version != cache->versions[i])
+      goto miss;
+
+    return cache->bucket->value;
+  }
+
+miss:
+  cache->shape = shape;
+
+  for(i = 0; i < count; i++)
+  {
+    if(maps[i] == NULL)
+    {
+      long slot = ana_shape_slot(shape, thename);
+
+      cache->versions[i] = ANA_NAME_CACHE_SELF;
+
+      if(slot >= 0)
+      {
+        cache->slot  = slot;
+        cache->depth = i + 1;
+
+        return ana_get_instance(frame->self)->values[slot];
+      }
+
+      continue;
+    }
+
+    ana_map_bucket *bucket = ana_map_get_bucket((ana_object *)maps[i], 
+      thename);
+
+    cache->versions[i] = maps[i]->version;
+
+    if(bucket)
+    {
+      cache->bucket = bucket;
+      cache->depth  = i + 1;
+
+      return bucket->value;
+    }
+  }
+
+  cache->depth = 0;
+
+  return NULL;
+}
+
+/* Name resolution for LOAD_FAST when the slot has not been assigned yet */
+static inline ana_object *lookup_name(ana_frame *frame, ana_object *thename)
+{
+  ana_map *maps[ANA_NAME_CHAIN_MAX];
+  int count = name_chain(frame, maps);
+  int i;
+
+  for(i = 0; i < count; i++)
+  {
+    ana_object *result = maps[i] 
+      ? ana_map_get((ana_object *)maps[i], thename)
+      : ana_instance_get_property(ana_get_instance(frame->self), thename);
+
+    if(result)
+      return result;
+  }
+
+  return NULL;
+}
+
 static inline int setup_args(ana_vm *vm, ana_frame *frame, 
   ana_frame *execframe, ana_function *fn, int totalargs)
 {
@@ -27,27 +199,24 @@ static inline int setup_args(ana_vm *vm, ana_frame *frame,
   if(ana_get_array(call->parameters)->size == 1 
       && (fn->flags & COMO_FUNCTION_HAS_VARARGS))
   {
-    ana_object *paramname = ana_array_get(
-      call->parameters, 0);
-
     ana_object *vargs = ana_array_new(4);
 
-    GC_TRACK(vm, vargs);
+    /* the callee and its receiver are already off the stack, and the
+       arguments will be until the frame is pushed, don't collect here */
+    GC_TRACK_NO_SWEEP(vm, vargs);
 
-    vargs->refcount++;
+    ana_incref(vargs);
 
     while(totalargs--)
     {
       ana_object *theargvalue = pop2(frame);
       
-      theargvalue->refcount++;
+      ana_incref(theargvalue);
 
       ana_array_push(vargs, theargvalue);
     }  
 
-    ana_map_put(execframe->locals, paramname, 
-      ana_array_reverse(vargs)
-    );
+    store_arg(execframe, call, 0, ana_array_reverse(vargs));
   }
   else if(ana_get_array(call->parameters)->size > 1 
       && (fn->flags & COMO_FUNCTION_HAS_VARARGS))
@@ -66,8 +235,7 @@ static inline int setup_args(ana_vm *vm, ana_frame *frame,
 
     for(i = 0; i < ana_array_size(call->parameters) - 1; i++)
     {
-      ana_map_put(execframe->locals, 
-        ana_array_get(call->parameters, i), ana_array_get(arguments, i));
+      store_arg(execframe, call, i, ana_array_get(arguments, i));
 
       position++;
     }
@@ -79,12 +247,9 @@ static inline int setup_args(ana_vm *vm, ana_frame *frame,
       ana_array_push(vargs, ana_array_get(arguments, position));
     }
 
-    ana_map_put(execframe->locals,
-      ana_array_get(call->parameters, ana_array_size(call->parameters) - 1),
-      vargs
-    );
+    store_arg(execframe, call, ana_array_size(call->parameters) - 1, vargs);
 
-    GC_TRACK(vm, vargs);
+    GC_TRACK_NO_SWEEP(vm, vargs);
 
     ana_object_dtor(arguments);
   }
@@ -94,18 +259,117 @@ static inline int setup_args(ana_vm *vm, ana_frame *frame,
     {
       ana_object *theargvalue = pop2(frame);
 
-      theargvalue->refcount++;
+      ana_incref(theargvalue);
 
-      ana_object *paramname = ana_array_get(
-        call->parameters, (ana_size_t)totalargs);
-
-      ana_map_put(execframe->locals, paramname, theargvalue);
+      store_arg(execframe, call, (ana_size_t)totalargs, theargvalue);
     }
   }
 
   return retval;
 }
 
+/* Drops a frame an exception is unwinding through */
+static inline void discard_frame(ana_vm *vm, ana_frame *frame)
+{
+  while(frame->sp > 0)
+    ana_release(frame->stack[--frame->sp]);
+
+  release_locals(frame);
+
+  ana_object_finalize(frame);
+  ana_object_dtor(frame);
+
+  if(vm->base_frame == frame)
+    vm->base_frame = NULL;
+}
+
+/*
+ * Runs a call in tail position in the caller's own frame, the arguments
+ * become its locals and it restarts at the callee's first instruction.
+ * Returns 1 when the frame can't be reused, the call is then made as an
+ * ordinary one. The callable is on top of the stack, above its arguments
+ */
+static inline int tail_call(ana_vm *vm, ana_frame *frame, int argcount)
+{
+  ana_object *function = frame->stack[frame->sp - 1];
+  ana_function *fn;
+  ana_function_defn *call;
+  ana_object **args;
+  ana_size_t sz, nlocals, base, i;
+
+  if(!ana_type_is(function, ana_function_type))
+    return 1;
+
+  fn = ana_get_function(function);
+
+  if((fn->flags & COMO_FUNCTION_LANG) != COMO_FUNCTION_LANG
+      || (fn->flags & COMO_FUNCTION_HAS_VARARGS))
+    return 1;
+
+  call = fn->func;
+
+  /* constructors, modules and the main frame don't just return a value, 
+     and a try block has to stay around for its handler */
+  if(frame == vm->global_frame || frame->retval 
+      || (frame->flags & COMO_FRAME_MODULE)
+      || ana_function_defn_findhandler(frame->defn, frame->pc - 1) != NULL
+      || ana_array_size(call->parameters) != (ana_size_t)argcount)
+    return 1;
+
+  nlocals = ana_array_size(call->local_names);
+  sz = call->max_stack + COMO_FRAME_STACK_SLACK;
+
+  if(nlocals > frame->slots)
+    return 1;
+
+  if(sz > frame->sz && ((frame->flags & COMO_FRAME_OWNS_STACK)
+      || frame->stack + frame->sz != vm->value_stack_top
+      || (ana_size_t)(vm->value_stack_end - frame->stack) < sz))
+    return 1;
+
+  base = frame->sp - 1 - (ana_size_t)argcount;
+  args = &frame->stack[base];
+
+  for(i = 0; i < (ana_size_t)argcount; i++)
+    ana_incref(args[i]);
+
+  release_locals(frame);
+  ana_map_clear(frame->locals);
+
+  for(i = 0; i < base; i++)
+    ana_release(frame->stack[i]);
+
+  frame->code       = call->code;
+  frame->code_size  = call->code_size;
+  frame->defn       = call;
+  frame->jump_table = call->jump_table;
+  frame->name       = fn->name;
+  frame->self       = NULL;
+  frame->pc         = 0;
+  frame->sp         = 0;
+  frame->loop_depth = 0;
+  frame->nlocals    = nlocals;
+  frame->fastlocals = nlocals > 0 ? frame->slot_storage : NULL;
+
+  if(nlocals > 0)
+    memset(frame->slot_storage, 0, sizeof(ana_object *) * nlocals);
+
+  /* the window only shrinks while it's on top, so the frame can give it 
+     back when it's released */
+  if(!(frame->flags & COMO_FRAME_OWNS_STACK) 
+      && frame->stack + frame->sz == vm->value_stack_top)
+  {
+    frame->sz = sz;
+    vm->value_stack_top = frame->stack + sz;
+  }
+
+  /* the arguments are still in place below the new stack pointer */
+  for(i = 0; i < (ana_size_t)argcount; i++)
+    store_arg(frame, call, i, args[i]);
+
+  return 0;
+}
+
 static inline int invoke_function(
   ana_vm *vm,
   ana_object *self,
@@ -129,14 +393,11 @@ static inline int invoke_function(
       struct _ana_function_def *call = fn->func;
 
       ana_frame *execframe = ana_frame_new(
-        call->code,
-        call->code_size,
-        call->jump_targets, 
-        call->line_mapping, 
+        vm,
+        call,
         vm->global_frame->locals,
         fn->name, 
         frame,
-        frame->current_line,
         frame->filename
       );
 
@@ -161,16 +422,14 @@ static inline int invoke_function(
     }
     else
     {
-      ana_object *nativeargs = ana_array_new(4);
+      /* the arguments stay on the stack, reachable, until it returns */
+      ana_object *res = fn->handler(self, &frame->stack[frame->sp - argcount],
+        argcount); 
 
-      while(argcount--)
-      {
-        ana_object *thearg = pop();
-
-        ana_array_push(nativeargs, thearg);
-      }       
+      frame->sp -= argcount;
 
-      ana_object *res = fn->handler(nativeargs); 
+      if(self && !ana_is_immortal(self))
+        GC_WRITTEN(vm, self);
 
       if(res) 
       {
@@ -179,8 +438,6 @@ static inline int invoke_function(
         pushto(frame, res);
       }
 
-      ana_object_dtor(nativeargs);
-
       return 1;
     }
   }
@@ -221,6 +478,10 @@ static inline int invoke_class(
 
   GC_TRACK(vm, invoked_instance);
 
+  /* Base instances hang off the most child one as they're created, holding 
+     it keeps the whole chain alive while the constructors are set up */
+  ana_incref(most_child_instance);
+
   ana_object   *instances = ana_array_new(4);
   ana_size_t i;
 
@@ -241,14 +502,11 @@ static inline int invoke_class(
     if(invoked_constructor)
     { 
       invoked_constructor_frame = (ana_frame *)ana_frame_new(
-        ana_get_function_defn(invoked_constructor)->code,
-        ana_get_function_defn(invoked_constructor)->code_size,
-        ana_get_function_defn(invoked_constructor)->jump_targets, 
-        ana_get_function_defn(invoked_constructor)->line_mapping, 
+        vm,
+        ana_get_function_defn(invoked_constructor),
         vm->global_frame->locals,
         invoked_constructor->name, 
         frame,
-        frame->current_line,
         frame->filename
       );
 
@@ -259,6 +517,8 @@ static inline int invoke_class(
         invoked_constructor, argcount) != 0)
       {
         ana_object_dtor(invoked_constructor);
+
+        ana_release((ana_object *)most_child_instance);
         
         return 1;
       }
@@ -302,18 +562,27 @@ static inline int invoke_class(
         Ana_SetError(AnaTypeError, 
           "%s is not a class", ana_cstring(invoked_class->c_base));
 
+        ana_release((ana_object *)most_child_instance);
+
         return 1;
       } 
       else if(!temp)
       {
+        ana_release((ana_object *)most_child_instance);
 
         return 1;
       } 
       
       invoked_class = ana_get_class(temp);
-      invoked_instance = (ana_instance *)ana_instance_new((ana_object *)invoked_class);
+      ana_instance *base_instance = 
+          (ana_instance *)ana_instance_new((ana_object *)invoked_class);
+
+      GC_TRACK(vm, base_instance);
 
-      GC_TRACK(vm, invoked_instance);
+      invoked_instance->base_instance = (ana_object *)base_instance;
+
+      GC_WRITE_BARRIER(vm, invoked_instance, base_instance);
+      invoked_instance = base_instance;
     }
     else
     {
@@ -327,16 +596,6 @@ static inline int invoke_class(
   }
 
   ana_size_t sp = vm->stackpointer - invoked_constructors;
-  
-  for(i = 0; i < ana_array_size(instances); i++)
-  {
-    ana_instance *inst = ana_get_instance(ana_array_get(instances, i));
-
-    if(i + 1 < ana_array_size(instances))
-    {      
-      inst->base_instance = ana_array_get(instances, i + 1);
-    }
-  }
 
   assert(sp >= 0);
 
@@ -363,14 +622,16 @@ static inline int invoke_class(
 
   ana_object_dtor(instances);
 
+  ana_release((ana_object *)most_child_instance);
+
   return invoked_constructors;
 }
 
 static inline ana_object *mul(ana_vm *vm, ana_object *a, ana_object *b)
 {
-  if(a->type->obj_binops != NULL && a->type->obj_binops->obj_mul != NULL) 
+  if(ana_type_of(a)->obj_binops != NULL && ana_type_of(a)->obj_binops->obj_mul != NULL) 
   {
-    ana_object *res = a->type->obj_binops->obj_mul(a, b);
+    ana_object *res = ana_type_of(a)->obj_binops->obj_mul(a, b);
     if(res) 
     {
       GC_TRACK(vm, res);
@@ -382,9 +643,9 @@ static inline ana_object *mul(ana_vm *vm, ana_object *a, ana_object *b)
 
 static inline ana_object *sub(ana_vm *vm, ana_object *a, ana_object *b)
 {
-  if(a->type->obj_binops != NULL && a->type->obj_binops->obj_sub != NULL) 
+  if(ana_type_of(a)->obj_binops != NULL && ana_type_of(a)->obj_binops->obj_sub != NULL) 
   {
-    ana_object *res = a->type->obj_binops->obj_sub(a, b);
+    ana_object *res = ana_type_of(a)->obj_binops->obj_sub(a, b);
     
     if(res) 
     {
@@ -396,12 +657,231 @@ static inline ana_object *sub(ana_vm *vm, ana_object *a, ana_object *b)
   return NULL;
 }
 
+/* The property cache of the instruction being executed */
+static inline ana_prop_cache *prop_cache_at(ana_frame *frame)
+{
+  ana_function_defn *defn = frame->defn;
+  ana_size_t pc = frame->pc - 1;
+
+  if(!defn->prop_cache)
+    defn->prop_cache = calloc(defn->code_size, sizeof(ana_prop_cache *));
+
+  if(!defn->prop_cache[pc])
+    defn->prop_cache[pc] = calloc(1, sizeof(ana_prop_cache));
+
+  return defn->prop_cache[pc];
+}
+
+static inline ana_instance *prop_cache_owner(ana_prop_cache_entry *entry, 
+  ana_instance *ins)
+{
+  int i;
+
+  for(i = 0; i < entry->owner; i++)
+    ins = ana_get_instance(ins->base_instance);
+
+  return ins;
+}
+
+/* The entry recorded for the class and shapes of the receiver, if any */
+static inline ana_prop_cache_entry *prop_cache_find(ana_prop_cache *cache,
+  ana_instance *receiver)
+{
+  int i, j;
+
+  for(i = 0; i < cache->count; i++)
+  {
+    ana_prop_cache_entry *entry = &cache->entries[i];
+    ana_instance *ins = receiver;
+
+    if(entry->klass != receiver->self)
+      continue;
+
+    for(j = 0; j < entry->nshapes; j++)
+    {
+      if(!ins || ins->shape != entry->shapes[j])
+        break;
+
+      ins = ana_get_instance(ins->base_instance);
+    }
+
+    if(j < entry->nshapes)
+      continue;
+
+    /* a member is found past the shapes, and a missing name needs the 
+       chain to end where it did */
+    if(entry->owner == entry->nshapes ? ins != NULL 
+        : entry->owner >= 0 || ins == NULL)
+      return entry;
+  }
+
+  return NULL;
+}
+
+static inline void prop_cache_add(ana_prop_cache *cache, 
+  ana_prop_cache_entry *entry)
+{
+  if(cache->count < ANA_PROP_CACHE_WAYS)
+  {
+    cache->entries[cache->count++] = *entry;
+  }
+  else
+  {
+    cache->entries[cache->next] = *entry;
+    cache->next = (cache->next + 1) % ANA_PROP_CACHE_WAYS;
+  }
+}
+
+/* 
+ * Resolves name on an instance, a class member comes before the 
+ * properties at each level of the base instance chain. entry records the
+ * lookup, its klass is left NULL when the chain is too deep to cache. A
+ * name that isn't found gets owner -1 and the shapes of the whole chain
+ */
+static inline ana_object *instance_lookup(ana_instance *receiver, 
+  ana_object *name, ana_prop_cache_entry *entry)
+{
+  ana_instance *ins = receiver;
+  ana_object *res = NULL;
+  int depth = 0;
+
+  entry->klass = receiver->self;
+  entry->owner = -1;
+  entry->slot = -1;
+  entry->value = NULL;
+  entry->transition = NULL;
+
+  while(ins)
+  {
+    assert(ins->self);
+    assert(ins->self->members);
+
+    res = ana_map_get(ins->self->members, name);
+
+    if(res)
+    {
+      entry->value = res;
+      entry->owner = depth;
+      entry->nshapes = depth;
+      break;
+    }
+
+    if(depth < ANA_PROP_CACHE_DEPTH)
+      entry->shapes[depth] = ins->shape;
+    else
+      entry->klass = NULL;
+
+    entry->slot = ana_shape_slot(ins->shape, name);
+
+    if(entry->slot >= 0)
+    {
+      res = ins->values[entry->slot];
+      entry->owner = depth;
+      entry->nshapes = depth + 1;
+      break;
+    }
+
+    ins = ana_get_instance(ins->base_instance);
+    depth++;
+  }
+
+  if(!res)
+    entry->nshapes = depth;
+
+  return res;
+}
+
+/* 
+ * Property resolution shared by GETPROP and LOAD_METHOD, functions found 
+ * on instances are only wrapped in a bounded function when bind is set. 
+ * Returns NULL with an exception set if the property can't be resolved
+ */
+static inline ana_object *getprop(ana_vm *vm, ana_frame *frame,
+  ana_object *instance, ana_object *name, int bind)
+{
+  ana_object *res = NULL;
+
+  if(ana_type_is(instance, ana_module_type))
+  {
+    res = ana_map_get(ana_get_module(instance)->members, name);
+
+    if(!res)
+      set_except("KeyError", "%s", ana_cstring(name));
+  }
+  else if(ana_type_is(instance, ana_map_type)) 
+  {
+    res = ana_map_get(instance, name);
+
+    if(!res)
+      set_except("KeyError", "%s", ana_cstring(name));
+  }
+  else if(ana_type_of(instance)->obj_props != NULL)
+  {
+    /* NO GC, since these are only builtin methods, sometimes */
+    res = ana_map_get(ana_type_of(instance)->obj_props, name);
+
+    if(!res) 
+    {
+      set_except("RuntimeError", "can't get property on object of type %s",
+        ana_type_name(instance)); 
+    }
+  }
+  else if(ana_type_is(instance, ana_instance_type))
+  {
+    /* Method resolution for instances
+     * 
+     * class definition, functions 
+     * properties
+     * base instances
+     */
+    ana_instance *ins = ana_get_instance(instance);
+    ana_prop_cache *cache = prop_cache_at(frame);
+    ana_prop_cache_entry *entry = prop_cache_find(cache, ins);
+
+    if(entry)
+    {
+      res = entry->slot >= 0 
+        ? prop_cache_owner(entry, ins)->values[entry->slot] 
+        : entry->value;
+    }
+    else
+    {
+      ana_prop_cache_entry fill;
+
+      res = instance_lookup(ins, name, &fill);
+
+      if(res && fill.klass)
+        prop_cache_add(cache, &fill);
+    }
+
+    if(!res)
+    {
+      Ana_SetError(AnaRuntimeError, "%s is not defined on %s instance",
+        ana_get_string(name)->value, 
+        ana_cstring(ana_get_instance(instance)->self->name));
+    }
+    else if(bind && ana_type_is(res, ana_function_type))
+    {
+      res = ana_bounded_function_new(instance, ana_get_function(res));
+
+      GC_TRACK(vm, res);
+    }
+  }
+  else 
+  {
+    Ana_SetError(AnaRuntimeError, "can't get property on object of type %s",
+      ana_type_name(instance));
+  }
+
+  return res;
+}
+
 static inline ana_object *getindex(ana_vm *vm, ana_object *container, 
   ana_object *idx)
 {
-  if(container->type->obj_seqops != NULL && container->type->obj_seqops->get != NULL)
+  if(ana_type_of(container)->obj_seqops != NULL && ana_type_of(container)->obj_seqops->get != NULL)
   {
-    ana_object *res = container->type->obj_seqops->get(container, idx);
+    ana_object *res = ana_type_of(container)->obj_seqops->get(container, idx);
 
     if(!res)
     {
@@ -429,32 +909,29 @@ static inline ana_object *setindex(ana_vm *vm, ana_object *container,
   ana_object *idx, ana_object *val)
 {
 
-  if(container->type->obj_seqops != NULL && container->type->obj_seqops->set != NULL)
+  if(ana_type_of(container)->obj_seqops != NULL && ana_type_of(container)->obj_seqops->set != NULL)
   {
     ana_object *prev = NULL;
 
-    if(container->type->obj_seqops != NULL && container->type->obj_seqops->get != NULL)
+    if(ana_type_of(container)->obj_seqops != NULL && ana_type_of(container)->obj_seqops->get != NULL)
     {
-      prev = container->type->obj_seqops->get(container, idx);
+      prev = ana_type_of(container)->obj_seqops->get(container, idx);
     }
 
-    ana_object *res = container->type->obj_seqops->set(container, idx, val);
+    ana_object *res = ana_type_of(container)->obj_seqops->set(container, idx, val);
 
     if(!res)
       return ANA_KEY_NOT_FOUND;
 
+    GC_WRITE_BARRIER(vm, container, idx);
+    GC_WRITE_BARRIER(vm, container, val);
+
     /* array values and map values, are already part of the GC root */
     if(!ana_type_is(container, ana_array_type) 
       && !ana_type_is(container, ana_map_type))
         GC_TRACK(vm, res);
 
-    if(prev && prev->refcount > 0) 
-    {
-      decref_recursively(prev);
-    }
-
-    incref_recursively(res);
-    //->refcount++;
+    (void)prev;
 
     return res;
   }
@@ -466,9 +943,9 @@ static inline ana_object *do_div(ana_vm *vm, ana_object *a, ana_object *b)
 {
   ana_object *retval = NULL;
 
-  if(a->type->obj_binops != NULL && a->type->obj_binops->obj_div != NULL) 
+  if(ana_type_of(a)->obj_binops != NULL && ana_type_of(a)->obj_binops->obj_div != NULL) 
   {
-    retval = a->type->obj_binops->obj_div(a, b);
+    retval = ana_type_of(a)->obj_binops->obj_div(a, b);
     if(retval)
       GC_TRACK(vm, retval);
   }
@@ -648,14 +1125,11 @@ static inline int import_file(ana_vm *vm, ana_frame *frame, ana_object *alias,
   code->filename = ana_stringfromstring(path);
 
   ana_frame *execframe = ana_frame_new(
-    ana_get_function_defn(code->func)->code,
-    ana_get_function_defn(code->func)->code_size,    
-    ana_get_function_defn(code->func)->jump_targets, 
-    ana_get_function_defn(code->func)->line_mapping, 
+    vm,
+    ana_get_function_defn(code->func),
     vm->global_frame->locals,
     code->name,
     frame,
-    frame->current_line,
     pathobj
   );
 
@@ -0,0 +1,259 @@
+/* Generated by scripts/genopcodes.py from opcodes.h, do not edit */
+static void *opcode_targets[256] = {
+  &&target_IUNARYMINUS,
+  &&target_ITHROW,
+  &&target_JMP,
+  &&target_JMPZ,
+  &&target_default,
+  &&target_SETUP_CATCH,
+  &&target_LOAD_SUBSCRIPT,
+  &&target_STORE_SUBSCRIPT,
+  &&target_INITARRAY,
+  &&target_INITOBJ,
+  &&target_SETPROP,
+  &&target_GETPROP,
+  &&target_IRETURN,
+  &&target_LOAD_CONST,
+  &&target_STORE_NAME,
+  &&target_LOAD_NAME,
+  &&target_IDIV,
+  &&target_IADD,
+  &&target_ILTE,
+  &&target_ITIMES,
+  &&target_IMINUS,
+  &&target_CALL,
+  &&target_IUNARYPLUS,
+  &&target_IUNARYNOT,
+  &&target_IEQUAL,
+  &&target_INEQUAL,
+  &&target_IREM,
+  &&target_IIMPORT,
+  &&target_default,
+  &&target_IIN,
+  &&target_BEGIN_LOOP,
+  &&target_END_LOOP,
+  &&target_EXIT_LOOP_CONTINUE,
+  &&target_DEFINE_FUNCTION,
+  &&target_DEFINE_CLASS,
+  &&target_ILSHFT,
+  &&target_IRSHFT,
+  &&target_IGTE,
+  &&target_IGT,
+  &&target_ILT,
+  &&target_CALL_METHOD,
+  &&target_ILAND,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_ILOR,
+  &&target_ITER,
+  &&target_ITER_MV,
+  &&target_JMPF,
+  &&target_JMPT,
+  &&target_LOAD_METHOD,
+  &&target_IADD_LL,
+  &&target_IMINUS_LL,
+  &&target_ITIMES_LL,
+  &&target_IDIV_LL,
+  &&target_IREM_LL,
+  &&target_ILT_LL,
+  &&target_IGT_LL,
+  &&target_ILTE_LL,
+  &&target_IGTE_LL,
+  &&target_IADD_DD,
+  &&target_IMINUS_DD,
+  &&target_ITIMES_DD,
+  &&target_IDIV_DD,
+  &&target_LOAD_FAST,
+  &&target_STORE_FAST,
+  &&target_TAILCALL,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default,
+  &&target_default
+};
@@ -6,7 +6,7 @@
 #define ITHROW 0x01
 #define JMP 0x02
 #define JMPZ 0x03
-#define TRY 0x04
+#define TRY 0x04 /* unused, try blocks are in the exception table */
 #define SETUP_CATCH 0x05
 #define LOAD_SUBSCRIPT 0x06
 #define STORE_SUBSCRIPT 0x07
@@ -49,6 +49,27 @@
 #define ITER_MV           0x32
 #define JMPF              0x33
 #define JMPT              0x34
-#define ANA_LAST_OPCODE   0x35
+#define LOAD_METHOD       0x35
+
+/* Type specialized opcodes, only written by the VM when quickening */
+#define IADD_LL           0x36
+#define IMINUS_LL         0x37
+#define ITIMES_LL         0x38
+#define IDIV_LL           0x39
+#define IREM_LL           0x3A
+#define ILT_LL            0x3B
+#define IGT_LL            0x3C
+#define ILTE_LL           0x3D
+#define IGTE_LL           0x3E
+#define IADD_DD           0x3F
+#define IMINUS_DD         0x40
+#define ITIMES_DD         0x41
+#define IDIV_DD           0x42
+
+/* Locals resolved to a frame slot at compile time */
+#define LOAD_FAST         0x43
+#define STORE_FAST        0x44
+#define TAILCALL          0x45
+#define ANA_LAST_OPCODE   0x46
 
 #endif
\ No newline at end of file
@@ -10,7 +10,21 @@
 #define COMO_VM_GC_DISABLED    (1 << 2)
 #define COMO_VM_TRACING_ANY    (COMO_VM_TRACING | COMO_VM_LIVE_TRACING)
 
-#define COMO_VM_STACK_MAX 255
+#define COMO_VM_STACK_MAX (1 << 16)   /* default for --max-stack-depth */
+#define COMO_VM_STACK_CHUNK 256       /* the frame stack grows by this much */
+#define COMO_VM_VALUE_STACK_SIZE (1 << 16)
+#define COMO_VM_FRAME_POOL_MAX 256
+
+/* Bits of ana_object.flags, owned by the collector */
+#define ANA_GC_MARKED     (1 << 0)
+#define ANA_GC_OLD        (1 << 1)  /* survived a collection */
+#define ANA_GC_REMEMBERED (1 << 2)  /* old, and may reference young objects */
+#define ANA_GC_GRAY       (1 << 3)  /* marked, its children are not yet */
+
+/* Phases of an incremental major collection */
+#define ANA_GC_IDLE     0
+#define ANA_GC_MARKING  1
+#define ANA_GC_SWEEPING 2
 
 typedef struct ana_vm ana_vm;
 
@@ -19,13 +33,37 @@ struct ana_vm
   ana_object *symbols;
   ana_object *constants;
   ana_object *exception;
-  ana_frame  *stack[COMO_VM_STACK_MAX];
-  ana_size_t stacksize;
+  ana_frame  **stack;
+  ana_size_t stacksize;         /* capacity, a chunk past max_stack_depth 
+                                   once it's been reached */
+  ana_size_t stacklimit;        /* pushes from here on grow or raise */
   ana_size_t stackpointer;
+  ana_size_t max_stack_depth;
+  ana_object **value_stack;     /* operand stacks of the live frames */
+  ana_object **value_stack_top;
+  ana_object **value_stack_end;
+  ana_frame *frame_pool;        /* released frames, linked by base.next */
+  ana_size_t frame_pool_size;
   ana_uint32_t flags;
-  ana_size_t nobjs;
-  ana_size_t mxobjs;
+  ana_size_t nobjs;             /* young objects, linked from root */
+  ana_size_t mxobjs;            /* young objects before a minor collection */
   ana_object *root; 
+  ana_object *old;              /* objects promoted by a collection */
+  ana_size_t nold;
+  ana_size_t mxold;             /* old objects before a major collection */
+  ana_object **remembered;      /* old objects written with young values */
+  ana_size_t nremembered;
+  ana_size_t remembered_capacity;
+  ana_size_t gc_skip;           /* flags that stop the marking of an object */
+  int gc_state;
+  ana_size_t gc_pause;          /* microseconds per slice, 0 stops the world */
+  ana_object **gray;            /* marked objects whose children aren't */
+  ana_size_t ngray;
+  ana_size_t gray_capacity;
+  ana_object *gc_cursor;        /* next old object to check for a count */
+  ana_object *gc_sweeping;      /* old objects taken off the list to sweep */
+  ana_object **gc_sweep_at;     /* where the sweep is in them */
+  int gc_threads;               /* threads marking a full collection */
   ana_object *self_symbol;
   ana_object *base_symbol;
   ana_frame *base_frame;
@@ -36,8 +74,12 @@ struct ana_vm
 
 ana_vm *ana_vm_new();
 void ana_vm_finalize(ana_vm *vm);
+void ana_vm_set_max_stack_depth(ana_vm *vm, ana_size_t depth);
 int ana_eval(ana_vm *vm, ana_function *function, char *function_name);
 ana_object *ana_vm_new_symbol(ana_vm *vm, char *symbol);
+void ana_vm_set_gc_pause(ana_vm *vm, ana_size_t usecs);
+void ana_vm_set_gc_threads(ana_vm *vm, int nthreads);
+void ana_vm_write_barrier(ana_vm *vm, ana_object *obj);
 
 #define make_symbol(vm, symbol) \
   (ana_array_push(vm->symbols, ana_stringfromstring((symbol))), \
@@ -45,30 +87,61 @@ ana_object *ana_vm_new_symbol(ana_vm *vm, char *symbol);
 
 #define NEW_SYMBOL make_symbol
   
+/* Immediates and immortals are never tracked */
 #define GC_TRACK(vm, obj) do { \
-  if (vm->nobjs == vm->mxobjs) \
+  if(!ana_is_immortal(obj)) \
   { \
-    vm->do_gc(vm); \
+    if (vm->nobjs >= vm->mxobjs) \
+    { \
+      vm->do_gc(vm); \
+    } \
+    ana_get_base(obj)->is_tracked = 1; \
+    ana_get_base(obj)->next = vm->root; \
+    vm->root = ana_get_base(obj); \
+    vm->nobjs++; \
   } \
-  ana_get_base(obj)->is_tracked = 1; \
-  ana_get_base(obj)->next = vm->root; \
-  vm->root = ana_get_base(obj); \
-  vm->nobjs++; \
 } while(0)
 
+/* Values of a tracked container can already be tracked, and maybe old */
 #define GC_TRACK_NO_SWEEP(vm, obj) do { \
-  ana_get_base(obj)->is_tracked = 1; \
-  ana_get_base(obj)->next = vm->root; \
-  vm->root = ana_get_base(obj); \
-  vm->nobjs++; \
+  if(!ana_is_immortal(obj) && !ana_get_base(obj)->is_tracked) \
+  { \
+    ana_get_base(obj)->is_tracked = 1; \
+    ana_get_base(obj)->next = vm->root; \
+    vm->root = ana_get_base(obj); \
+    vm->nobjs++; \
+  } \
+} while(0)
+
+/* A minor collection doesn't trace old objects, one that may now hold a 
+   young object is remembered and traced as a root instead. While a major 
+   collection marks incrementally, a written object that was already 
+   traced goes back to gray */
+#define GC_WRITTEN(vm, obj) do { \
+  if((ana_get_base(obj)->flags & (ANA_GC_OLD | ANA_GC_REMEMBERED)) \
+      == ANA_GC_OLD \
+    || (ana_get_base(obj)->flags & (ANA_GC_MARKED | ANA_GC_GRAY)) \
+      == ANA_GC_MARKED) \
+    ana_vm_write_barrier(vm, ana_get_base(obj)); \
+} while(0)
+
+#define GC_WRITE_BARRIER(vm, container, value) do { \
+  if(!ana_is_immortal(value) \
+      && (!(ana_get_base(value)->flags & ANA_GC_OLD) \
+        || vm->gc_state == ANA_GC_MARKING)) \
+    GC_WRITTEN(vm, container); \
 } while(0)
 
 /* Todo, this isn't recursive for now */
 #define GC_TRACK_DIMENSIONAL(vm, obj) do { \
-  if (vm->nobjs == vm->mxobjs) \
+  if(ana_is_immortal(obj)) \
+    break; \
+  \
+  if (vm->nobjs >= vm->mxobjs) \
   { \
     vm->do_gc(vm); \
   } \
+  ana_get_base(obj)->is_tracked = 1; \
   ana_get_base(obj)->next = vm->root; \
   vm->root = ana_get_base(obj); \
   vm->nobjs++; \
@@ -3,11 +3,38 @@
 
 #define ANA_TRACE_DEBUG_ENABLED
 
-#define vm_case(o) switch(o)
-#define vm_target(x) case x: \
+/* Threaded dispatch is used when the compiler supports labels as values,
+   build with -DANA_NO_COMPUTED_GOTO to fall back to the switch */
+#if defined(__GNUC__) && !defined(ANA_NO_COMPUTED_GOTO)
+# define ANA_USE_COMPUTED_GOTO
+#endif
+
+#ifdef ANA_USE_COMPUTED_GOTO
+# define vm_case(o) goto *opcode_targets[o];
+# define vm_target(x) target_##x: \
   TRACE(x, #x, oparg, 0, 1); \
 
-#define vm_continue() break
+# define vm_default() target_default:
+# define vm_dispatch() do { \
+  fetch(); \
+  goto *opcode_targets[opcode]; \
+} while(0)
+/* Each handler checks for a pending exception and dispatches the next
+   opcode itself, so there is no shared jump back to the top of the loop */
+# define vm_continue() do { \
+  if(ex || ana_excep) \
+    goto vm_next; \
+  vm_dispatch(); \
+} while(0)
+#else
+# define vm_case(o) switch(o)
+# define vm_target(x) case x: \
+  TRACE(x, #x, oparg, 0, 1); \
+
+# define vm_default() default:
+# define vm_dispatch() goto top
+# define vm_continue() goto vm_next
+#endif
 
 #ifdef ANA_TRACE_DEBUG_ENABLED
 # define DO_TRACE(op, strop, arg, flag, argused) \
@@ -24,14 +51,14 @@
     } \
   } while(0)
   
-# define TRACE(op, strop, arg, flag, argused) \
+# define TRACE_HOOK(op, strop, arg, flag, argused) \
   if(1) \
   { \
     if(vm->flags & COMO_VM_TRACING) \
     { \
       DO_TRACE(op, strop, arg, flag, argused); \
       if(op != IRETURN) \
-        break; \
+        vm_continue(); \
       else \
         goto exit; \
       } \
@@ -41,57 +68,45 @@
     } \
   } \
 
-#else
-#   define TRACE(op, strop, arg, flag, argused) do {} while(0)
 #endif
 
 
 #define fetch() do { \
-  assert(frame->line_mapping); \
-  ana_object *pc = ana_longfromlong((long)frame->pc); \
-  ana_object *theline = ana_map_get(frame->line_mapping, pc); \
-  \
-  if(theline) {\
-    current_line = (int)ana_get_long(theline)->value; \
-    frame->current_line = current_line; \
-  } \
-  else {\
-    current_line = 0; \
-  } \
-  ana_object_dtor(pc); \
-  \
   opline = *(code + frame->pc); \
   opcode = (opline >> 24) & 0xff; \
   oparg = (opline >> 8) & 0xffff; \
   opflag =  (opline) & 0xff; \
   frame->pc++;  \
-  \
-  if(frame->pc != frame->code_size) \
-  { \
-    ana_uint32_t next_op_line = *(code + frame->pc); \
-    next_op_code = (next_op_line >> 24) & 0xff; \
-  } \
-  else { \
-    next_op_code = -1; \
-  } \
+} while(0)
+
+/* Rewrites the opcode of the instruction being executed, keeping its
+   argument and flag */
+#define quicken(op) \
+  (code[frame->pc - 1] = ((ana_uint32_t)(op) << 24) | (opline & 0x00ffffff))
+
+/* Falls back to the generic opcode and executes it in place of the
+   specialized one */
+#define deoptimize(op) do { \
+  quicken(op); \
+  frame->pc--; \
+  vm_dispatch(); \
 } while(0)
 
 #define get_const(x) (constants[x])
 #define get_arg() (oparg)
 
-#define push_ex(frame, arg) do { \
-  assert(frame); \
-  if(frame->sp >= frame->sz) \
-  { \
-    frame->sz = frame->sz * 2; \
-    frame->stack = realloc(frame->stack, sizeof(ana_object *) * frame->sz); \
-  } \
+/* Frames are sized by the compiler for the deepest their stack gets, build
+   with -DANA_STACK_DEBUG to check that on every push */
+#ifdef ANA_STACK_DEBUG
+# define push_ex(frame, arg) do { \
+  assert(frame->sp < frame->sz); \
   frame->stack[frame->sp++] = arg; \
-  if(frame->loop->stack_size != 0) { \
-    ana_size_t pos = frame->loop->stack_position == 0 ? 0 : (frame->loop->stack_position - 1);\
-    frame->loop->stack[pos]->stack_obj_count++; \
-  } \
 } while(0)
+#else
+# define push_ex(frame, arg) do { \
+  frame->stack[frame->sp++] = arg; \
+} while(0)
+#endif
 
 #define push(arg) push_ex(frame, arg)
 
@@ -102,15 +117,16 @@
  (frame->stack[--frame->sp])
 
 #define pop_ex() \
- ((frame->loop->stack_size != 0 ? (--frame->loop->stack[frame->loop->stack_position == 0 ? 0 : \
-    (frame->loop->stack_position - 1)]->stack_obj_count) : -1), (frame->stack[--frame->sp]))
+ (frame->stack[--frame->sp])
 
 #define pop2(frame) \
- ((frame->loop->stack_size != 0 ? (--frame->loop->stack[frame->loop->stack_position == 0 ? 0 : \
-    (frame->loop->stack_position - 1)]->stack_obj_count) : -1), (frame->stack[--frame->sp]))
+ (frame->stack[--frame->sp])
 
 #define pop pop_ex
 
+#define peek(n) \
+ (frame->stack[frame->sp - (n)])
+
 #define empty() \
   (frame->sp == 0)
 
@@ -6,9 +6,12 @@
 
 ana_object *ana_array_empty;
 
-static ana_object *ana_array_push_wrap(ana_object *arrayobj, ana_object *value)
+static ana_object *ana_array_push_wrap(ana_object *arrayobj, 
+  ana_object **argv, int argc)
 {
-  value->refcount++;
+  ana_object *value = argv[0];
+
+  COMO_UNUSED(argc);
 
   ana_object *res = ana_array_push(arrayobj, value);
 
@@ -16,9 +19,11 @@ static ana_object *ana_array_push_wrap(ana_object *arrayobj, ana_object *value)
 }
 
 
-static ana_object *array_length(ana_object *arrayobj, ana_object *arg)
+static ana_object *array_length(ana_object *arrayobj, ana_object **argv,
+  int argc)
 {
-  COMO_UNUSED(arg);
+  COMO_UNUSED(argv);
+  COMO_UNUSED(argc);
 
   ana_array *self = ana_get_array(arrayobj);
 
@@ -27,19 +32,23 @@ static ana_object *array_length(ana_object *arrayobj, ana_object *arg)
   return result;
 }
 
-static ana_object *array_getType(ana_object *arrayobj, ana_object *arg)
+static ana_object *array_getType(ana_object *arrayobj, ana_object **argv,
+  int argc)
 {
   COMO_UNUSED(arrayobj);
-  COMO_UNUSED(arg);
+  COMO_UNUSED(argv);
+  COMO_UNUSED(argc);
 
   ana_object *res = ana_stringfromstring("array");
 
   return res;
 }
 
-static ana_object *array_first(ana_object *arrayobj, ana_object *arg)
+static ana_object *array_first(ana_object *arrayobj, ana_object **argv,
+  int argc)
 {
-  COMO_UNUSED(arg);
+  COMO_UNUSED(argv);
+  COMO_UNUSED(argc);
 
   ana_array *self = ana_get_array(arrayobj);
 
@@ -149,7 +158,7 @@ static ana_object *array_get(ana_object *obj, ana_object *index)
   
   if(ana_type_is(index, ana_long_type))
   {
-    long value = ana_get_long(index)->value;
+    long value = ana_long_value(index);
 
     if(value >= 0 && value < self->size)
       return self->items[value];
@@ -165,10 +174,14 @@ static ana_object *array_set(ana_object *obj, ana_object *index,
   
   if(ana_type_is(index, ana_long_type))
   {
-    long value = ana_get_long(index)->value;
+    long value = ana_long_value(index);
 
     if(value >= 0 && value < self->size)
+    {
+      ana_array_touch(self, value);
+
       return self->items[value] = val;
+    }
   }
 
   return NULL;
@@ -218,6 +231,7 @@ COMO_OBJECT_API ana_object *ana_array_new(ana_size_t capacity)
   obj->size = 0;
   obj->capacity = capacity;
   obj->items = malloc(sizeof(ana_object *) * capacity);
+  obj->dirty = 0;
 
   return (ana_object *)obj;
 }
@@ -235,6 +249,8 @@ COMO_OBJECT_API ana_object *ana_array_push(ana_object *xself,
     self->capacity = newcap;
   }
   
+  ana_array_touch(self, self->size);
+
   self->items[self->size++] = value;
 
   return value;
@@ -259,6 +275,8 @@ COMO_OBJECT_API ana_object *ana_array_push_index(ana_object *xself,
   ana_size_t i, 
   ana_object *value)
 { 
+  ana_array_touch(ana_get_array(xself), i);
+
   ana_get_array(xself)->items[i] = value;
   
   return value;
@@ -273,6 +291,8 @@ COMO_OBJECT_API ana_object *ana_array_reverse(ana_object *obj)
   ana_size_t end = self->size - 1;
   ana_size_t start = 0;
 
+  ana_array_touch(self, 0);
+
   while(end > start)
   {
     ana_object *temp = self->items[end]; 
@@ -296,12 +316,13 @@ static ana_object *ana_array_iterator_next(ana_array_iterator *iter)
 
 static ana_object *array_iterator_get(ana_object *obj)
 { 
-  obj->refcount++;
+  ana_incref(obj);
 
   ana_array_iterator *iter = malloc(sizeof(*iter));
 
   iter->base.flags = 0;
   iter->base.refcount = 0;
+  iter->base.is_tracked = 0;
   iter->base.type = &ana_array_iterator_type;
   iter->base.next = NULL;
 
@@ -315,7 +336,7 @@ static void array_iterator_dtor(ana_object *iterobj)
 { 
   ana_array_iterator *iter = (ana_array_iterator *)iterobj;
 
-  ana_get_base(iter->array)->refcount--;
+  ana_decref(ana_get_base(iter->array));
 
   free(iter);
 }
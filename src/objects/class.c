@@ -1,5 +1,87 @@
 #include <ana.h>
 
+static ana_shape *shape_new(ana_shape *parent, ana_object *name)
+{
+  ana_shape *shape = malloc(sizeof(*shape));
+
+  shape->parent = parent;
+  shape->name = name;
+  shape->slots = ana_map_new(parent ? parent->nslots + 1 : 4);
+  shape->nslots = 0;
+  shape->transitions = NULL;
+  shape->ntransitions = 0;
+  shape->transitions_capacity = 0;
+
+  if(parent)
+  {
+    ana_map_foreach(parent->slots, key, value) {
+      ana_map_put(shape->slots, key, value);
+    } ana_map_foreach_end();
+
+    shape->nslots = parent->nslots;
+  }
+
+  if(name)
+  {
+    ana_map_put(shape->slots, name, ana_longfromlong((long)shape->nslots));
+    shape->nslots++;
+  }
+
+  return shape;
+}
+
+static void shape_free(ana_shape *shape)
+{
+  ana_size_t i;
+
+  for(i = 0; i < shape->ntransitions; i++)
+    shape_free(shape->transitions[i]);
+
+  free(shape->transitions);
+  ana_object_dtor(shape->slots);
+  free(shape);
+}
+
+/* The child of shape that adds name, created the first time it's taken */
+static ana_shape *shape_transition(ana_shape *shape, ana_object *name)
+{
+  ana_size_t i;
+  ana_shape *next;
+
+  for(i = 0; i < shape->ntransitions; i++)
+  {
+    if(ana_object_equals(shape->transitions[i]->name, name))
+      return shape->transitions[i];
+  }
+
+  if(shape->ntransitions == shape->transitions_capacity)
+  {
+    shape->transitions_capacity = shape->transitions_capacity 
+      ? shape->transitions_capacity * 2 : 2;
+
+    shape->transitions = realloc(shape->transitions, 
+      sizeof(ana_shape *) * shape->transitions_capacity);
+  }
+
+  next = shape_new(shape, name);
+
+  shape->transitions[shape->ntransitions++] = next;
+
+  return next;
+}
+
+COMO_OBJECT_API long ana_shape_slot(ana_shape *shape, ana_object *name)
+{
+  ana_object *slot;
+
+  if(shape->nslots == 0)
+    return -1;
+
+  slot = ana_map_get(shape->slots, name);
+
+  return slot ? ana_long_value(slot) : -1;
+}
+
 COMO_OBJECT_API ana_object *ana_class_new(ana_object *base, ana_object *name)
 {
   ana_class *obj = malloc(sizeof(*obj));
@@ -13,6 +95,7 @@ COMO_OBJECT_API ana_object *ana_class_new(ana_object *base, ana_object *name)
   obj->c_base = base;
   obj->members = ana_map_new(4);
   obj->name = name;
+  obj->root_shape = shape_new(NULL, NULL);
 
   return (ana_object *)obj;
 }
@@ -47,6 +130,8 @@ static void class_dtor(ana_object *obj)
   ana_class *theclass = (ana_class *)obj;
 
   ana_object_dtor(theclass->members);
+
+  shape_free(theclass->root_shape);
   
   free(theclass);
 }
@@ -78,13 +163,55 @@ COMO_OBJECT_API ana_object *ana_instance_new(ana_object *class_defn)
 
   obj->base_instance = NULL;
   obj->self          = (ana_class *)class_defn;
-  ana_get_base(obj->self)->refcount++;
-  obj->properties    = ana_map_new(4);
+  ana_incref(ana_get_base(obj->self));
+  obj->shape         = obj->self->root_shape;
+  obj->values        = NULL;
+  obj->capacity      = 0;
   obj->module = NULL;
   
   return (ana_object *)obj; 
 }
 
+COMO_OBJECT_API ana_object *ana_instance_get_property(ana_instance *ins,
+  ana_object *name)
+{
+  long slot = ana_shape_slot(ins->shape, name);
+
+  return slot >= 0 ? ins->values[slot] : NULL;
+}
+
+/* Stores value in the slot of name, moving the instance to a new shape 
+   if it doesn't have that property yet */
+COMO_OBJECT_API ana_object *ana_instance_set_property(ana_instance *ins,
+  ana_object *name, ana_object *value)
+{
+  long slot = ana_shape_slot(ins->shape, name);
+
+  if(slot < 0)
+  {
+    ana_instance_set_shape(ins, shape_transition(ins->shape, name));
+    slot = (long)ins->shape->nslots - 1;
+  }
+
+  ins->values[slot] = value;
+
+  return value;
+}
+
+/* Moves the instance to a shape with more slots, the new slots are 
+   uninitialized */
+COMO_OBJECT_API void ana_instance_set_shape(ana_instance *ins, 
+  ana_shape *shape)
+{
+  ins->shape = shape;
+
+  if(shape->nslots > ins->capacity)
+  {
+    ins->capacity = ins->capacity ? ins->capacity * 2 : 4;
+    ins->values = realloc(ins->values, sizeof(ana_object *) * ins->capacity);
+  }
+}
+
 static int instance_equals(ana_object *a, ana_object *b)
 {
   return a == b;
@@ -116,9 +243,9 @@ static void instance_dtor(ana_object *obj)
 {  
   ana_instance *self = (ana_instance *)obj;
 
-  ana_get_base(self->self)->refcount--;
+  ana_decref(ana_get_base(self->self));
 
-  ana_object_dtor(self->properties);
+  free(self->values);
   
   free(self);
 }
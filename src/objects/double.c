@@ -8,6 +8,9 @@
 
 COMO_OBJECT_API ana_object *ana_doublefromdouble(double dval)
 {
+  if(LIKELY(ana_flonum_fits(dval)))
+    return ana_flonum_from(dval);
+
   ana_double *obj = malloc(sizeof(*obj));
 
   obj->base.type = &ana_double_type;
@@ -22,24 +25,22 @@ COMO_OBJECT_API ana_object *ana_doublefromdouble(double dval)
 
 static void double_print(ana_object *ob)
 {
-  ana_double *dval = (ana_double *)ob;
-
   /* check out DBL_DECIMAL_DIG */
-  printf("%.17g",  dval->value);
+  printf("%.17g", ana_double_value(ob));
 }
 
 static ana_object *double_string(ana_object *obj)
 {
-  ana_double *self = ana_get_double(obj);
+  double self = ana_double_value(obj);
   char *buffer = NULL;
   int size = 0;
-  size =  snprintf(buffer, size, "%.17g", self->value);
+  size =  snprintf(buffer, size, "%.17g", self);
 
   size++;
 
   buffer = malloc(size);
 
-  snprintf(buffer, size, "%.17g", self->value);
+  snprintf(buffer, size, "%.17g", self);
 
   buffer[size - 1] = '\0';
 
@@ -63,24 +64,37 @@ static int double_equals(ana_object *a, ana_object *b)
   if(ana_type_is(a, ana_double_type) 
     && ana_type_is(b, ana_double_type))
   {
-    retval = ((ana_double *)a)->value == ((ana_double *)b)->value;
+    retval = ana_double_value(a) == ana_double_value(b);
   }
 
   return retval;
 }
 
+/* Flonums of equal value are identical, boxed doubles are not, so
+ * equality always compares values
+ */
+static ana_object *double_equals_wrap(ana_object *a, ana_object *b)
+{
+  return ana_boolfromint(double_equals(a, b));
+}
+
+static ana_object *double_not_equals_wrap(ana_object *a, ana_object *b)
+{
+  return ana_boolfromint(!double_equals(a, b));
+}
+
 static ana_object *double_add(ana_object *xself, ana_object *a)
 {
-  ana_double *self = (ana_double *)xself;
+  double self = ana_double_value(xself);
   ana_object *retval = NULL;
   
   if(ana_type_is(a, ana_double_type))
-    retval = ana_doublefromdouble(self->value + 
-                  ((ana_double *)a)->value);
+    retval = ana_doublefromdouble(self + 
+                  ana_double_value(a));
 
   else if(ana_type_is(a, ana_long_type))
-      retval = ana_doublefromdouble(self->value + 
-                  (double)((ana_long *)a)->value);
+      retval = ana_doublefromdouble(self + 
+                  (double)ana_long_value(a));
   
 
   return retval; 
@@ -88,55 +102,55 @@ static ana_object *double_add(ana_object *xself, ana_object *a)
 
 static ana_object *double_mul(ana_object *obj, ana_object *x)
 {  
-  ana_double *self   = ana_get_double(obj);
+  double self = ana_double_value(obj);
   ana_object *retval = NULL;
   
   if(ana_type_is(x, ana_double_type))
-    retval = ana_doublefromdouble(self->value * ((ana_double *)x)->value);
+    retval = ana_doublefromdouble(self * ana_double_value(x));
   
   else if(ana_type_is(x, ana_long_type))
-    retval = ana_doublefromdouble(self->value * (double)((ana_long *)x)->value);  
+    retval = ana_doublefromdouble(self * (double)ana_long_value(x));  
 
   return retval;
 }
 
 static ana_object *double_div(ana_object *obj, ana_object *x)
 {
-  ana_double *self   = ana_get_double(obj);
+  double self = ana_double_value(obj);
   ana_object *retval = NULL;
   
   if(ana_type_is(x, ana_double_type))
-    retval = ana_doublefromdouble(self->value / ((ana_double *)x)->value);
+    retval = ana_doublefromdouble(self / ana_double_value(x));
   
   else if(ana_type_is(x, ana_long_type))
-    retval = ana_doublefromdouble(self->value / (double)((ana_long *)x)->value);  
+    retval = ana_doublefromdouble(self / (double)ana_long_value(x));  
 
   return retval;
 }
 
 static ana_object *double_sub(ana_object *obj, ana_object *x)
 {
-  ana_double *self   = ana_get_double(obj);
+  double self = ana_double_value(obj);
   ana_object *retval = NULL;
   
   if(ana_type_is(x, ana_double_type))
-    retval = ana_doublefromdouble(self->value - ((ana_double *)x)->value);
+    retval = ana_doublefromdouble(self - ana_double_value(x));
   
   else if(ana_type_is(x, ana_long_type))
-    retval = ana_doublefromdouble(self->value - (double)((ana_long *)x)->value);  
+    retval = ana_doublefromdouble(self - (double)ana_long_value(x));  
 
   return retval;
 }
 
 static ana_object *double_rem(ana_object *obj, ana_object *x)
 {
-  ana_double *self   = ana_get_double(obj);
+  double self = ana_double_value(obj);
   ana_object *retval = NULL;
   
   if(ana_type_is(x, ana_double_type)) 
   {
-    double dividend = self->value;
-    double divisor = ((ana_double *)x)->value;
+    double dividend = self;
+    double divisor = ana_double_value(x);
     
     retval = ana_doublefromdouble(
       dividend - (divisor * ((int)dividend/(int)divisor))
@@ -144,8 +158,8 @@ static ana_object *double_rem(ana_object *obj, ana_object *x)
   } 
   else if(ana_type_is(x, ana_long_type))
   {
-    double dividend = self->value;
-    double divisor = (double)(((ana_long *)x)->value);
+    double dividend = self;
+    double divisor = (double)(ana_long_value(x));
 
     /* 269.86 % 100 = 269.86 - (100 * int(269.86/100)) */
     /* http://www2.nkfust.edu.tw/~mhchen/papers/Psychologica\
@@ -160,21 +174,21 @@ static ana_object *double_rem(ana_object *obj, ana_object *x)
 
 static ana_object *double_plus(ana_object *obj)
 {
-  ana_double *self = ana_get_double(obj);
+  double self = ana_double_value(obj);
 
-  return ana_doublefromdouble(+self->value); 
+  return ana_doublefromdouble(+self); 
 }
 
 static ana_object *double_minus(ana_object *obj)
 {
-  ana_double *self = ana_get_double(obj);
+  double self = ana_double_value(obj);
 
-  return ana_doublefromdouble(-self->value); 
+  return ana_doublefromdouble(-self); 
 }
 
 static int double_bool(ana_object *obj)
 {
-  return ((ana_double *)obj)->value != 0.0;
+  return ana_double_value(obj) != 0.0;
 }
 
 static ana_binary_ops binops = {
@@ -193,8 +207,8 @@ static ana_unary_ops unops = {
 };
 
 static ana_comparison_ops compops = {
-  .obj_eq  = NULL,
-  .obj_neq = NULL,
+  .obj_eq  = double_equals_wrap,
+  .obj_neq = double_not_equals_wrap,
   .obj_gt  = NULL,
   .obj_lt  = NULL,
   .obj_gte = NULL,
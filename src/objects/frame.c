@@ -1,18 +1,43 @@
 #include <ana.h>
 #include <assert.h>
 
+/* 
+ * Takes a frame from the vm's pool, growing it when the function needs 
+ * more slots than it has. A frame is one allocation with its slots and 
+ * try blocks inline, and it keeps its locals map across calls
+ */
+static ana_frame *frame_alloc(ana_vm *vm, ana_size_t nlocals)
+{
+  ana_frame *obj = vm->frame_pool;
+
+  if(obj != NULL)
+  {
+    vm->frame_pool = (ana_frame *)obj->base.next;
+    vm->frame_pool_size--;
+  }
+
+  if(obj == NULL || obj->slots < nlocals)
+  {
+    ana_object *locals = obj ? obj->locals : NULL;
+
+    obj = realloc(obj, sizeof(*obj) + sizeof(ana_object *) * nlocals);
+    obj->slots = nlocals;
+    obj->locals = locals ? locals : ana_map_new(4);
+  }
+
+  return obj;
+}
+
 ana_frame *ana_frame_new(
-  unsigned int *code,
-  ana_size_t code_size,
-  ana_object *jumptargets, 
-  ana_object *line_mapping, 
+  ana_vm *vm,
+  ana_function_defn *defn,
   ana_object *global_variables, 
   ana_object *name, 
   ana_frame *caller, 
-  int line, 
   ana_object *filename)
 {
-  ana_frame *obj = malloc(sizeof(*obj));
+  ana_size_t nlocals = ana_array_size(defn->local_names);
+  ana_frame *obj = frame_alloc(vm, nlocals);
 
   obj->base.type = &ana_frame_type;
   obj->base.next = NULL;
@@ -20,43 +45,44 @@ ana_frame *ana_frame_new(
   obj->base.refcount = 0;
   obj->base.is_tracked = 0;
 
-  obj->code             = code;
-  obj->code_size        = code_size;
+  obj->code             = defn->code;
+  obj->code_size        = defn->code_size;
+  obj->defn             = defn;
   obj->flags            = 0;
   obj->pc               = 0;
-  obj->current_line     = 0;
-  obj->stack            = malloc(sizeof(ana_object *) * COMO_FRAME_STACK_SIZE); 
-  obj->sz               = COMO_FRAME_STACK_SIZE;
+  obj->sz               = defn->max_stack + COMO_FRAME_STACK_SLACK;
+  obj->vm               = vm;
   obj->sp               = 0;
-  obj->locals           = ana_map_new(4);
+  obj->nlocals          = nlocals;
+  obj->fastlocals       = nlocals > 0 ? obj->slot_storage : NULL;
   obj->globals          = global_variables;
   obj->self             = NULL;
 
-  obj->loop                     = malloc(sizeof(*obj->loop));  
-  obj->loop->stack              = malloc(sizeof(ana_basic_block *) * COMO_BLOCK_STACK_MAX);
-  obj->loop->root               = NULL;
-  obj->loop->stack_size         = 0;
-  obj->loop->stack_capacity     = COMO_BLOCK_STACK_MAX;
-  obj->loop->stack_position     = 0;
+  if(nlocals > 0)
+    memset(obj->slot_storage, 0, sizeof(ana_object *) * nlocals);
 
+  obj->loop_depth       = 0;
 
-  obj->exception                 = malloc(sizeof(*obj->exception));
-  obj->exception->stack          = malloc(sizeof(ana_basic_block *) * COMO_BLOCK_STACK_MAX);
-  obj->exception->root           = NULL;
-  obj->exception->stack_size     = 0;
-  obj->exception->stack_capacity = COMO_FRAME_STACK_SIZE;
-  obj->exception->stack_position = 0;
-
-  obj->jump_targets           = jumptargets;
+  obj->jump_table             = defn->jump_table;
   obj->name                   = name;
-
-  obj->activation_line_number = line;
-  obj->line_mapping           = line_mapping;
   obj->filename               = filename;
   obj->caller                 = caller;
   obj->retval                 = NULL;
   obj->module = NULL;
 
+  /* the deepest the stack can get is known, so the frame takes a window 
+     of the value stack and pushes never check the size */
+  if((ana_size_t)(vm->value_stack_end - vm->value_stack_top) >= obj->sz)
+  {
+    obj->stack = vm->value_stack_top;
+    vm->value_stack_top += obj->sz;
+  }
+  else
+  {
+    obj->stack = malloc(sizeof(ana_object *) * obj->sz);
+    obj->flags |= COMO_FRAME_OWNS_STACK;
+  }
+
   return obj;
 }
 
@@ -64,63 +90,58 @@ ana_frame *ana_frame_new(
 static void frame_dtor(ana_object *obj)
 {
   ana_frame *self = ana_get_frame(obj);
-  ana_basic_block *loop_root = self->loop->root;
-  ana_basic_block *exception_root = self->exception->root;
-  ana_basic_block *next;
+  ana_vm *vm = self->vm;
 
-  while(loop_root)
+  if(self->flags & COMO_FRAME_OWNS_STACK)
   {
-    next = loop_root->next;
-
-    free(loop_root);
-    
-    loop_root = next;
+    free(self->stack);
   }
-
-  while(exception_root)
+  else if(self->stack + self->sz == vm->value_stack_top)
   {
-    next = exception_root->next;
-    
-    free(exception_root);
-
-    exception_root = next;
+    vm->value_stack_top = self->stack;
   }
 
-  free(self->loop->stack);
-  free(self->loop);
+  /* a module keeps the locals of its frame as its members */
+  if(self->flags & COMO_FRAME_MODULE)
+    self->locals = ana_map_new(4);
+  else
+    ana_map_clear(self->locals);
 
-  free(self->exception->stack);
-  free(self->exception);
-
-  free(self->stack);
-  
-  if(!(self->flags & COMO_FRAME_MODULE))
+  if(vm->frame_pool_size >= COMO_VM_FRAME_POOL_MAX)
   {
     ana_object_dtor(self->locals);
+    free(self);
+    return;
   }
 
-  free(self);
+  /* frames are never on the gc list, so the link is free to use */
+  self->base.next = (ana_object *)vm->frame_pool;
+  vm->frame_pool = self;
+  vm->frame_pool_size++;
 }
 
-
-COMO_OBJECT_API ana_basic_block *ana_basic_block_new(int targetaddress)
+COMO_OBJECT_API void ana_frame_type_finalize(ana_vm *vm)
 {
-  ana_basic_block *block = malloc(sizeof(*block));
-  
-  block->jmpto = targetaddress;
+  while(vm->frame_pool != NULL)
+  {
+    ana_frame *next = (ana_frame *)vm->frame_pool->base.next;
+
+    ana_object_dtor(vm->frame_pool->locals);
+    free(vm->frame_pool);
+
+    vm->frame_pool = next;
+  }
 
-  return block;
+  vm->frame_pool_size = 0;
 }
 
-COMO_OBJECT_API void ana_frame_growstack(ana_object *obj)
+/* The line of the instruction last fetched, looked up on demand */
+COMO_OBJECT_API int ana_frame_getline(ana_frame *frame)
 {
-  ana_frame *self = ana_get_frame(obj);
+  if(frame->pc == 0)
+    return 0;
 
-  if(self->sp >= self->sz)
-  {
-    self->sz = self->sz * 2;
-    self->stack = realloc(self->stack, sizeof(ana_object *) * self->sz);
-  }
+  return ana_function_defn_getline(frame->defn, frame->pc - 1);
 }
 
 static void frame_init(ana_object *obj)
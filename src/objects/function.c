@@ -14,8 +14,20 @@ static ana_function_defn *ana_new_function_defn(void)
   obj->code          = malloc(sizeof(unsigned int) * COMO_CODE_SIZE);
   obj->code_size     = 0;
   obj->code_capacity = COMO_CODE_SIZE;
-  obj->line_mapping = ana_map_new(4);
+  obj->line_table          = NULL;
+  obj->line_table_size     = 0;
+  obj->line_table_capacity = 0;
+  obj->line_table_pc       = 0;
+  obj->line_table_line     = 0;
   obj->jump_targets = ana_array_new(4);
+  obj->jump_table   = NULL;
+  obj->jump_table_size = 0;
+  obj->max_stack    = 0;
+  obj->local_names  = ana_array_new(4);
+  obj->name_cache   = NULL;
+  obj->prop_cache   = NULL;
+  obj->handlers     = NULL;
+  obj->nhandlers    = 0;
  
   return obj;
 }
@@ -29,6 +41,7 @@ static ana_function *create_function(char *filename, char *name, int type)
   obj->base.flags = 0;
   obj->flags = type;
   obj->base.refcount = 0;
+  obj->base.is_tracked = 0;
   obj->name = ana_stringfromstring(name);
   obj->filename = ana_stringfromstring(filename);
   
@@ -54,11 +67,31 @@ static void function_dtor(ana_object *obj)
 
     free(self->func->code);
 
-    ana_map_foreach_kv_apply(self->func->line_mapping, ana_object_dtor);
-    ana_object_dtor(self->func->line_mapping);
+    free(self->func->line_table);
+
+    free(self->func->name_cache);
+
+    if(self->func->prop_cache)
+    {
+      ana_size_t i;
+
+      for(i = 0; i < self->func->code_size; i++)
+        free(self->func->prop_cache[i]);
+
+      free(self->func->prop_cache);
+    }
 
-    ana_array_foreach_apply(self->func->jump_targets, ana_object_dtor);
-    ana_object_dtor(self->func->jump_targets);
+    if(self->func->jump_targets)
+    {
+      ana_array_foreach_apply(self->func->jump_targets, ana_object_dtor);
+      ana_object_dtor(self->func->jump_targets);
+    }
+
+    free(self->func->jump_table);
+    free(self->func->handlers);
+
+    ana_array_foreach_apply(self->func->local_names, ana_object_dtor);
+    ana_object_dtor(self->func->local_names);
     
     free(self->func);
   }
@@ -146,7 +179,7 @@ COMO_OBJECT_API ana_object *ana_function_defn_new(char *filename, char *name)
 
 
 COMO_OBJECT_API ana_object *ana_functionfromhandler(
-  char *filename, char *name, ana_function_handler handler)
+  char *filename, char *name, ana_native_handler handler)
 {
   ana_function *fn = create_function(filename, name, COMO_FUNCTION_NATIVE);
 
@@ -156,7 +189,7 @@ COMO_OBJECT_API ana_object *ana_functionfromhandler(
 }
 
 COMO_OBJECT_API ana_object *ana_methodfromhandler(
-  char *filename, char *name, ana_method_handler handler, ana_object *parameters)
+  char *filename, char *name, ana_native_handler handler, ana_object *parameters)
 {
 
   ana_function *fn = create_function(filename, name, 
@@ -240,4 +273,172 @@ COMO_OBJECT_API ana_object *ana_bounded_function_new(ana_object *inst,
   obj->func = func;
 
   return (ana_object *)obj;
-}
\ No newline at end of file
+}
+
+static void line_table_push(ana_function_defn *defn, ana_size_t pcdelta, 
+  int linedelta)
+{
+  if(defn->line_table_size + 2 > defn->line_table_capacity)
+  {
+    ana_size_t new_size = defn->line_table_capacity == 0 
+      ? COMO_CODE_SIZE : defn->line_table_capacity * 2;
+
+    unsigned char *new_table = realloc(defn->line_table, new_size);
+
+    if(!new_table)
+    {
+      ana_error_noreturn("failed to allocate a line table");
+    }
+
+    defn->line_table = new_table;
+    defn->line_table_capacity = new_size;
+  }
+
+  defn->line_table[defn->line_table_size++] = (unsigned char)pcdelta;
+  defn->line_table[defn->line_table_size++] = (unsigned char)(signed char)linedelta;
+}
+
+/* 
+ * The line table is a list of (pc delta, line delta) byte pairs, an entry
+ * is only written when the line changes. Deltas that don't fit in a byte
+ * are spread over several entries. Instructions must be added in order.
+ */
+COMO_OBJECT_API void ana_function_defn_addline(ana_function_defn *defn, 
+  ana_size_t pc, int line)
+{
+  ana_size_t pcdelta = pc - defn->line_table_pc;
+  int linedelta = line - defn->line_table_line;
+
+  if(linedelta == 0)
+    return;
+
+  while(pcdelta > 255)
+  {
+    line_table_push(defn, 255, 0);
+    pcdelta -= 255;
+  }
+
+  while(linedelta > 127)
+  {
+    line_table_push(defn, pcdelta, 127);
+    pcdelta = 0;
+    linedelta -= 127;
+  }
+
+  while(linedelta < -128)
+  {
+    line_table_push(defn, pcdelta, -128);
+    pcdelta = 0;
+    linedelta += 128;
+  }
+
+  line_table_push(defn, pcdelta, linedelta);
+
+  defn->line_table_pc = pc;
+  defn->line_table_line = line;
+}
+
+/* Returns the source line of the instruction at pc, or 0 if unknown */
+COMO_OBJECT_API int ana_function_defn_getline(ana_function_defn *defn, 
+  ana_size_t pc)
+{
+  ana_size_t i;
+  ana_size_t address = 0;
+  int line = 0;
+
+  for(i = 0; i < defn->line_table_size; i += 2)
+  {
+    address += defn->line_table[i];
+
+    if(address > pc)
+      break;
+
+    line += (signed char)defn->line_table[i + 1];
+  }
+
+  return line;
+}
+
+/* 
+ * Called once all code of a definition has been emitted, resolves the
+ * jump targets into a table of code offsets and frees the boxed ones
+ */
+COMO_OBJECT_API void ana_function_defn_finalize(ana_function_defn *defn)
+{
+  ana_size_t count = ana_array_size(defn->jump_targets);
+
+  defn->jump_table = malloc(sizeof(ana_uint32_t) * (count > 0 ? count : 1));
+  defn->jump_table_size = count;
+
+  ana_array_foreach(defn->jump_targets, index, value) {
+    assert(value != NULL);
+
+    defn->jump_table[index] = (ana_uint32_t)ana_long_value(value);
+
+    ana_object_dtor(value);
+  } ana_array_foreach_end();
+
+  ana_object_dtor(defn->jump_targets);
+  defn->jump_targets = NULL;
+}
+
+/* Returns the frame slot of a local variable, or -1 if it has none */
+COMO_OBJECT_API int ana_function_defn_getlocal(ana_function_defn *defn, 
+  char *name)
+{
+  ana_array_foreach(defn->local_names, index, value) {
+    if(strcmp(ana_cstring(value), name) == 0)
+      return (int)index;
+  } ana_array_foreach_end();
+
+  return -1;
+}
+
+/* Assigns a frame slot to a local variable, returning the slot */
+COMO_OBJECT_API int ana_function_defn_addlocal(ana_function_defn *defn, 
+  char *name)
+{
+  int slot = ana_function_defn_getlocal(defn, name);
+
+  if(slot != -1)
+    return slot;
+
+  ana_array_push(defn->local_names, ana_stringfromstring(name));
+
+  return (int)ana_array_size(defn->local_names) - 1;
+}
+
+/* Adds a try block, after any try blocks nested in it */
+COMO_OBJECT_API ana_exception_handler *ana_function_defn_addhandler(
+  ana_function_defn *defn, ana_size_t start, ana_size_t end, 
+  ana_size_t handler)
+{
+  ana_exception_handler *entry;
+
+  defn->handlers = realloc(defn->handlers, 
+    sizeof(ana_exception_handler) * (defn->nhandlers + 1));
+
+  entry = &defn->handlers[defn->nhandlers++];
+  entry->start      = (ana_uint32_t)start;
+  entry->end        = (ana_uint32_t)end;
+  entry->handler    = (ana_uint32_t)handler;
+  entry->sp         = 0;
+  entry->loop_depth = 0;
+
+  return entry;
+}
+
+/* The innermost try block covering pc, NULL if there is none */
+COMO_OBJECT_API ana_exception_handler *ana_function_defn_findhandler(
+  ana_function_defn *defn, ana_size_t pc)
+{
+  ana_size_t i;
+
+  for(i = 0; i < defn->nhandlers; i++)
+  {
+    if(pc >= defn->handlers[i].start && pc < defn->handlers[i].end)
+      return &defn->handlers[i];
+  }
+
+  return NULL;
+}
@@ -8,10 +8,12 @@
 
 #include <ana.h>
 
-static ana_object *long_getType(ana_object *longobj, ana_object *arg)
+static ana_object *long_getType(ana_object *longobj, ana_object **argv,
+  int argc)
 {
   COMO_UNUSED(longobj);
-  COMO_UNUSED(arg);
+  COMO_UNUSED(argv);
+  COMO_UNUSED(argc);
 
   ana_object *res = ana_stringfromstring("long");
 
@@ -42,6 +44,9 @@ COMO_OBJECT_API void ana_long_type_finalize(ana_vm *vm)
 
 COMO_OBJECT_API inline ana_object *ana_longfromlong(long lval)
 {
+  if(LIKELY(ana_small_fits(lval)))
+    return ana_small_from(lval);
+
   ana_long *obj = malloc(sizeof(*obj));
 
   obj->base.type = &ana_long_type;
@@ -56,9 +61,7 @@ COMO_OBJECT_API inline ana_object *ana_longfromlong(long lval)
 
 static void long_print(ana_object *ob)
 {
-  ana_long *lval = (ana_long *)ob;
-
-  printf("%ld", lval->value);
+  printf("%ld", ana_long_value(ob));
 }
 
 static inline void long_dtor(ana_object *ob)
@@ -75,9 +78,7 @@ static int long_equals(ana_object *base, ana_object *right)
   if(ana_type_is(base, ana_long_type) 
     && ana_type_is(right, ana_long_type)) {
 
-    ana_long *a = (ana_long *)base;
-    ana_long *b = (ana_long *)right;
-    retval = a->value == b->value;
+    retval = ana_long_value(base) == ana_long_value(right);
   }
 
   return retval;
@@ -85,9 +86,7 @@ static int long_equals(ana_object *base, ana_object *right)
 
 static ana_usize_t long_hash(ana_object *obj)
 {
-  ana_long *lval = (ana_long *)obj;
-
-  return lval->value & 0x7fffffffffffffffL;
+  return ana_long_value(obj) & 0x7fffffffffffffffL;
 }
 
 #define willoverflow(a, b) \
@@ -95,28 +94,28 @@ static ana_usize_t long_hash(ana_object *obj)
 
 static ana_object *long_add(ana_object *xself, ana_object *b)
 {
-  ana_long *self = (ana_long *)xself;
+  long self = ana_long_value(xself);
   ana_object *retval = NULL;
 
   if(ana_type_is(b, ana_long_type))
   {
-    long right = ((ana_long *)b)->value;
+    long right = ana_long_value(b);
 
-    if(willoverflow(self->value, right))
+    if(willoverflow(self, right))
     {
       retval = ana_longfromlong(-1L);
     }
     else
     {
-      retval = ana_longfromlong(self->value + right);
+      retval = ana_longfromlong(self + right);
     }
   }
   else 
   { 
     if(ana_type_is(b, ana_double_type))
     {
-      double left = (double)self->value;
-      double right = ((ana_double *)b)->value;
+      double left = (double)self;
+      double right = ana_double_value(b);
     
       retval = ana_doublefromdouble(left + right);
     }
@@ -127,12 +126,12 @@ static ana_object *long_add(ana_object *xself, ana_object *b)
 
 static ana_object *long_mul(ana_object *xself, ana_object *b)
 {
-  ana_long *self = ana_get_long(xself);
+  long self = ana_long_value(xself);
   ana_object *retval = NULL;
 
   if(ana_type_is(b, ana_long_type))
   {
-    long right = ((ana_long *)b)->value;
+    long right = ana_long_value(b);
 
     if(0 /*willoverflow */)
     {
@@ -140,15 +139,15 @@ static ana_object *long_mul(ana_object *xself, ana_object *b)
     }
     else
     {
-      retval = ana_longfromlong(self->value * right);
+      retval = ana_longfromlong(self * right);
     }
   }
   else 
   { 
     if(ana_type_is(b, ana_double_type))
     {
-      double left = (double)self->value;
-      double right = ((ana_double *)b)->value;
+      double left = (double)self;
+      double right = ana_double_value(b);
     
       retval = ana_doublefromdouble(left * right);
     }
@@ -159,12 +158,12 @@ static ana_object *long_mul(ana_object *xself, ana_object *b)
 
 static ana_object *long_div(ana_object *xself, ana_object *b)
 {
-  ana_long *self = ana_get_long(xself);
+  long self = ana_long_value(xself);
   ana_object *retval = NULL;
 
   if(ana_type_is(b, ana_long_type))
   {
-    long right = ((ana_long *)b)->value;
+    long right = ana_long_value(b);
 
     if(0 /*willoverflow */)
     {
@@ -178,15 +177,15 @@ static ana_object *long_div(ana_object *xself, ana_object *b)
         return NULL;
       }
 
-      retval = ana_longfromlong(self->value / right);
+      retval = ana_longfromlong(self / right);
     }
   }
   else 
   { 
     if(ana_type_is(b, ana_double_type))
     {
-      double left = (double)self->value;
-      double right = ((ana_double *)b)->value;
+      double left = (double)self;
+      double right = ana_double_value(b);
     
       retval = ana_doublefromdouble(left / right);
     }
@@ -197,12 +196,12 @@ static ana_object *long_div(ana_object *xself, ana_object *b)
 
 static ana_object *long_sub(ana_object *xself, ana_object *b)
 {
-  ana_long *self = ana_get_long(xself);
+  long self = ana_long_value(xself);
   ana_object *retval = NULL;
 
   if(ana_type_is(b, ana_long_type))
   {
-    long right = ((ana_long *)b)->value;
+    long right = ana_long_value(b);
 
     if(0 /*willoverflow */)
     {
@@ -211,15 +210,15 @@ static ana_object *long_sub(ana_object *xself, ana_object *b)
     else
     {
       /* TODO divide by zero and overflow */
-      retval = ana_longfromlong(self->value - right);
+      retval = ana_longfromlong(self - right);
     }
   }
   else 
   { 
     if(ana_type_is(b, ana_double_type))
     {
-      double left = (double)self->value;
-      double right = ((ana_double *)b)->value;
+      double left = (double)self;
+      double right = ana_double_value(b);
     
       retval = ana_doublefromdouble(left - right);
     }
@@ -230,13 +229,13 @@ static ana_object *long_sub(ana_object *xself, ana_object *b)
 
 static ana_object *long_rem(ana_object *xself, ana_object *right)
 {
-  ana_long *self = ana_get_long(xself);
+  long self = ana_long_value(xself);
   ana_object *retval = NULL;
   
   if(ana_type_is(right, ana_double_type)) 
   {
-    double dividend = (double)self->value;
-    double divisor = ((ana_double *)right)->value;
+    double dividend = (double)self;
+    double divisor = ana_double_value(right);
     
     /* http://www2.nkfust.edu.tw/~mhchen/papers/Psychologica\
      * l%20Barriers%20Effects%20on%20Futures%20Markets/mod.pdf
@@ -247,7 +246,7 @@ static ana_object *long_rem(ana_object *xself, ana_object *right)
   } 
   else if(ana_type_is(right, ana_long_type))
   {
-    retval = ana_longfromlong(self->value % ((ana_long *)right)->value);
+    retval = ana_longfromlong(self % ana_long_value(right));
   } 
 
   return retval;
@@ -255,25 +254,25 @@ static ana_object *long_rem(ana_object *xself, ana_object *right)
 
 static ana_object *long_plus(ana_object *obj)
 {
-  ana_long *self = ana_get_long(obj);
+  long self = ana_long_value(obj);
 
-  return ana_longfromlong(+self->value); 
+  return ana_longfromlong(+self); 
 }
 
 static ana_object *long_minus(ana_object *obj)
 {
-  ana_long *self = ana_get_long(obj);
+  long self = ana_long_value(obj);
 
-  return ana_longfromlong(-self->value); 
+  return ana_longfromlong(-self); 
 }
 
 static ana_object *long_string(ana_object *obj)
 {
-  ana_long *self = ana_get_long(obj);
+  long self = ana_long_value(obj);
   
   ana_object *retval;
 
-  ANA_AUTO_RELEASE(ana_build_str("%ld", self->value), {
+  ANA_AUTO_RELEASE(ana_build_str("%ld", self), {
     retval = ana_stringfromstring(value);
   });
 
@@ -292,7 +291,7 @@ static ana_object *long_neq(ana_object *a, ana_object *b)
 
 static ana_object *long_gt(ana_object *a, ana_object *b)
 {
-  ana_long *self = ana_get_long(a);
+  long self = ana_long_value(a);
 
   if(!ana_type_is(b, ana_long_type)) 
   {
@@ -301,12 +300,12 @@ static ana_object *long_gt(ana_object *a, ana_object *b)
     return NULL;
   }
   else
-    return ana_boolfromint(self->value > ((ana_long *)b)->value);
+    return ana_boolfromint(self > ana_long_value(b));
 }
 
 static ana_object *long_lt(ana_object *a, ana_object *b)
 {
-  ana_long *self = ana_get_long(a);
+  long self = ana_long_value(a);
 
   if(!ana_type_is(b, ana_long_type)) 
   {
@@ -316,13 +315,13 @@ static ana_object *long_lt(ana_object *a, ana_object *b)
     return NULL;
   }
   else
-    return (self->value < ((ana_long *)b)->value) ? 
+    return (self < ana_long_value(b)) ? 
       ana_bool_true : ana_bool_false;
 }
 
 static ana_object *long_gte(ana_object *a, ana_object *b)
 {
-  ana_long *self = ana_get_long(a);
+  long self = ana_long_value(a);
 
   if(!ana_type_is(b, ana_long_type)) 
   {
@@ -332,11 +331,11 @@ static ana_object *long_gte(ana_object *a, ana_object *b)
   }
   else
   {
-    ana_long *right = (ana_long *)b;
+    long right = ana_long_value(b);
 
-    if(self->value > right->value)
+    if(self > right)
       return ana_true;
-    else if(self->value == right->value)
+    else if(self == right)
       return ana_true;
     else
       return ana_false;
@@ -345,14 +344,14 @@ static ana_object *long_gte(ana_object *a, ana_object *b)
 
 static ana_object *long_lte(ana_object *a, ana_object *b)
 {
-  ana_long *self = ana_get_long(a);
+  long self = ana_long_value(a);
   long rightvalue = 0;
 
   if(!ana_type_is(b, ana_long_type)) 
   {
     if(ana_type_is(b, ana_double_type)) 
     {
-      rightvalue = (long)(ana_get_double(b)->value);
+      rightvalue = (long)(ana_double_value(b));
     }
     else
     {
@@ -364,12 +363,12 @@ static ana_object *long_lte(ana_object *a, ana_object *b)
   }
   else
   {
-    rightvalue = ana_get_long(b)->value;
+    rightvalue = ana_long_value(b);
   }
 
-  if(self->value < rightvalue)
+  if(self < rightvalue)
     return ana_bool_true;
-  else if(self->value == rightvalue)
+  else if(self == rightvalue)
     return ana_bool_true;
   else
     return ana_bool_false;
@@ -377,15 +376,15 @@ static ana_object *long_lte(ana_object *a, ana_object *b)
 
 static int long_bool(ana_object *obj)
 {
-  ana_long *self = ana_get_long(obj);
+  long self = ana_long_value(obj);
   
-  return self->value != 0L;
+  return self != 0L;
 }
 
 static ana_object *long_ls(ana_object *a, ana_object *b)
 {
-  ana_long *self = ana_get_long(a);
-  ana_long *right;
+  long self = ana_long_value(a);
+  long right;
 
   if(!ana_type_is(b, ana_long_type)) 
   {
@@ -394,17 +393,17 @@ static ana_object *long_ls(ana_object *a, ana_object *b)
     return NULL;
   }
 
-  right = ana_get_long(b);
+  right = ana_long_value(b);
 
-  long value = self->value << right->value;
+  long value = self << right;
 
   return ana_longfromlong(value);
 }
 
 static ana_object *long_rs(ana_object *a, ana_object *b)
 {
-  ana_long *self = ana_get_long(a);
-  ana_long *right;
+  long self = ana_long_value(a);
+  long right;
 
   if(!ana_type_is(b, ana_long_type)) 
   {
@@ -413,9 +412,9 @@ static ana_object *long_rs(ana_object *a, ana_object *b)
     return NULL;
   }
 
-  right = ana_get_long(b);
+  right = ana_long_value(b);
 
-  long value = self->value >> right->value;
+  long value = self >> right;
 
   return ana_longfromlong(value);
 }
@@ -11,6 +11,15 @@
   !((!ana_type_is(key, ana_string_type) \
     && !ana_type_is(key, ana_long_type))) 
 
+/* 
+ * Every map state gets a version no other map has had, so the version 
+ * alone tells an inline cache that both the map and its buckets are 
+ * unchanged. Value updates leave buckets in place and keep the version
+ */
+static ana_usize_t map_versions = 0;
+
+#define next_version() (++map_versions)
+
 #define maybe_resize(o) do { \
   ana_map *map = (ana_map *)(o); \
   if(map->size >= map->capacity) \
@@ -22,7 +31,7 @@ static inline ana_map_bucket *get_bucket(ana_map *map, ana_object *key,
 {
   ana_usize_t hashed = 
     ana_type_is(key, ana_string_type) ? ((ana_string *)key)->hash 
-    : (ana_usize_t)(((ana_long *)key)->value);
+    : (ana_usize_t)(ana_long_value(key));
 
   ana_usize_t index  = hashed % map->capacity;
   ana_map_bucket *bucket = map->buckets[index];
@@ -34,7 +43,7 @@ static inline ana_map_bucket *get_bucket(ana_map *map, ana_object *key,
     ana_map_bucket *next = bucket->next;
     ana_object *thiskey  = bucket->key;
 
-    if(thiskey->type->obj_equals(thiskey, key)) 
+    if(ana_type_of(thiskey)->obj_equals(thiskey, key)) 
     {
       retval = bucket;
       break;
@@ -97,6 +106,7 @@ COMO_OBJECT_API ana_object *ana_put_local_ex(
 
   map->buckets[idx] = bucket;
   map->size++;
+  map->version = next_version();
 
   return value;
 }
@@ -116,6 +126,7 @@ COMO_OBJECT_API ana_object *ana_map_new(ana_size_t size)
 
   map->capacity = size;
   map->size = 0;
+  map->version = next_version();
 
   map->buckets = malloc(sizeof(ana_map_bucket*) * size);
 
@@ -142,7 +153,7 @@ static inline void do_resize(ana_map *map)
     {
       ana_map_bucket *next = b->next;
 
-      ana_usize_t newidx = b->key->type->obj_hash(b->key) % newcap;
+      ana_usize_t newidx = ana_type_of(b->key)->obj_hash(b->key) % newcap;
       
       ana_map_bucket *bucket = malloc(sizeof(*bucket));
       bucket->key = b->key;
@@ -159,6 +170,7 @@ static inline void do_resize(ana_map *map)
   free(map->buckets);
   map->buckets  = newbuckets;
   map->capacity = newcap;
+  map->version  = next_version();
 }
 
 COMO_OBJECT_API ana_object *ana_map_put(ana_object *obj, 
@@ -196,6 +208,7 @@ COMO_OBJECT_API ana_object *ana_map_put(ana_object *obj,
 
   map->buckets[idx] = bucket;
   map->size++;
+  map->version = next_version();
 
 done:
   return value;
@@ -219,6 +232,17 @@ COMO_OBJECT_API ana_object *ana_map_get(ana_object *obj, ana_object *key)
   return NULL;
 }
 
+COMO_OBJECT_API ana_map_bucket *ana_map_get_bucket(ana_object *obj, 
+  ana_object *key)
+{
+  if(!key_type_valid(key)) 
+  {
+    return NULL;
+  }
+
+  return get_bucket((ana_map *)obj, key, NULL);
+}
+
 COMO_OBJECT_API ana_object *ana_map_delete(ana_object *obj, ana_object *key)
 {
   ana_map *map = (ana_map *)obj;
@@ -226,7 +250,7 @@ COMO_OBJECT_API ana_object *ana_map_delete(ana_object *obj, ana_object *key)
   if(!key_type_valid(key))
     return NULL;
 
-  ana_usize_t hashed = key->type->obj_hash(key);
+  ana_usize_t hashed = ana_type_of(key)->obj_hash(key);
   ana_size_t index  = hashed % map->capacity;
   ana_map_bucket *bucket = map->buckets[index];
   ana_map_bucket *prev = NULL;
@@ -237,7 +261,7 @@ COMO_OBJECT_API ana_object *ana_map_delete(ana_object *obj, ana_object *key)
     ana_map_bucket *next = bucket->next;
     ana_object *thiskey  = bucket->key;
 
-    if(thiskey->type->obj_equals(thiskey, key)) 
+    if(ana_type_of(thiskey)->obj_equals(thiskey, key)) 
     {
       if(prev) 
       {
@@ -251,6 +275,7 @@ COMO_OBJECT_API ana_object *ana_map_delete(ana_object *obj, ana_object *key)
       }
 
       map->size--;
+      map->version = next_version();
       return key;
     }
 
@@ -261,6 +286,33 @@ COMO_OBJECT_API ana_object *ana_map_delete(ana_object *obj, ana_object *key)
   return NULL;
 }
 
+/* Drops every key but keeps the bucket array, for maps that get reused */
+COMO_OBJECT_API void ana_map_clear(ana_object *obj)
+{
+  ana_map *map = (ana_map *)obj;
+  ana_usize_t i;
+
+  if(map->size == 0)
+    return;
+
+  for(i = 0; i < map->capacity; i++) 
+  {
+    ana_map_bucket *bucket = map->buckets[i];
+
+    while(bucket != NULL) 
+    {
+      ana_map_bucket *next = bucket->next;
+      free(bucket);
+      bucket = next;
+    }
+
+    map->buckets[i] = NULL;
+  }
+
+  map->size = 0;
+  map->version = next_version();
+}
+
 static void map_dtor(ana_object *ob)
 {
   ana_map *map = (ana_map *)ob;
@@ -376,6 +428,7 @@ static ana_object *map_iterator_get(ana_object *obj)
 
   iter->base.flags = 0;
   iter->base.refcount = 0;
+  iter->base.is_tracked = 0;
   iter->base.type = &ana_map_iterator_type;
   iter->base.next = NULL;
 
@@ -14,8 +14,10 @@ COMO_OBJECT_API ana_object *ana_module_new(char *name, ana_object *func)
   module->base.refcount = 0;
   module->base.is_tracked = 0;
 
-  module->name    = ana_stringfromstring(name);
-  module->func    = func;
+  module->name     = ana_stringfromstring(name);
+  module->func     = func;
+  module->members  = NULL;
+  module->filename = NULL;
 
   return (ana_object *)module;
 }
@@ -32,9 +34,13 @@ static inline void module_dtor(ana_object *ob)
   ana_module *self = ana_get_module(ob);
 
   ana_object_dtor(self->name);
-  ana_object_dtor(self->members);
   ana_object_dtor(self->func);
-  ana_object_dtor(self->filename);
+
+  if(self->members)
+    ana_object_dtor(self->members);
+
+  if(self->filename)
+    ana_object_dtor(self->filename);
 
   free(self);
 }
@@ -6,18 +6,22 @@
 
 #include <ana.h>
 
-static ana_object *string_length(ana_object *stringobj, ana_object *arg)
+static ana_object *string_length(ana_object *stringobj, ana_object **argv,
+  int argc)
 {
-  (void)arg;
+  COMO_UNUSED(argv);
+  COMO_UNUSED(argc);
   
   ana_object *retval = ana_longfromlong(ana_get_string(stringobj)->len);
 
   return retval;
 }
 
-static ana_object *string_getBytes(ana_object *stringobj, ana_object *arg)
+static ana_object *string_getBytes(ana_object *stringobj, ana_object **argv,
+  int argc)
 {
-  COMO_UNUSED(arg);
+  COMO_UNUSED(argv);
+  COMO_UNUSED(argc);
   
   ana_string *self = ana_get_string(stringobj);
 
@@ -43,10 +47,12 @@ static ana_object *string_getBytes(ana_object *stringobj, ana_object *arg)
   return bytes;
 }
 
-static ana_object *string_getType(ana_object *stringobj, ana_object *arg)
+static ana_object *string_getType(ana_object *stringobj, ana_object **argv,
+  int argc)
 {
   COMO_UNUSED(stringobj);
-  COMO_UNUSED(arg);
+  COMO_UNUSED(argv);
+  COMO_UNUSED(argc);
 
   ana_object *res = ana_stringfromstring("string");
 
@@ -113,8 +119,51 @@ static inline unsigned long hashlen(unsigned char *str, size_t size)
   return hash;
 }
 
+/* Every single byte string is shared, str_get and the string iterator
+ * return these instead of allocating a new string per index
+ */
+static ana_string single_byte_strings[256];
+static char single_byte_values[256][2];
+static int single_byte_strings_ready = 0;
+
+static void single_byte_strings_init(void)
+{
+  int i;
+
+  for(i = 0; i < 256; i++)
+  {
+    ana_string *obj = &single_byte_strings[i];
+
+    single_byte_values[i][0] = (char)i;
+    single_byte_values[i][1] = '\0';
+
+    obj->base.type = &ana_string_type;
+    obj->base.next = NULL;
+    obj->base.flags = 0;
+    obj->base.refcount = 0;
+    ana_make_immortal(obj);
+
+    obj->len = 1;
+    obj->hash = hashlen((unsigned char *)single_byte_values[i], 1);
+    obj->value = single_byte_values[i];
+  }
+
+  single_byte_strings_ready = 1;
+}
+
+static inline ana_object *single_byte_string(unsigned char c)
+{
+  if(UNLIKELY(!single_byte_strings_ready))
+    single_byte_strings_init();
+
+  return (ana_object *)&single_byte_strings[c];
+}
+
 static ana_object *ana_stringfromstringandlen(char *val, size_t len)
 {
+  if(len == 1)
+    return single_byte_string((unsigned char)val[0]);
+
   ana_string *obj = malloc(sizeof(*obj));
 
   /* TODO check if len overflows */
@@ -139,9 +188,13 @@ static ana_object *ana_stringfromstringandlen(char *val, size_t len)
 
 COMO_OBJECT_API ana_object *ana_stringfromstring(char *val)
 {
-  ana_string *obj = malloc(sizeof(*obj));
   size_t len = strlen(val);
 
+  if(len == 1)
+    return single_byte_string((unsigned char)val[0]);
+
+  ana_string *obj = malloc(sizeof(*obj));
+
   /* TODO check if len overflows */
 
   obj->base.type = &ana_string_type;
@@ -218,7 +271,7 @@ static ana_object *string_add(ana_object *a, ana_object *b)
 
   if(!ana_type_is(b, ana_string_type)) 
   {
-    s2 = (ana_string *)b->type->obj_str(b);
+    s2 = (ana_string *)ana_type_of(b)->obj_str(b);
     shouldfrees2 = 1;
   } 
   else 
@@ -250,7 +303,7 @@ static ana_object *str_get(ana_object *obj, ana_object *index)
   
   if(ana_type_is(index, ana_long_type))
   {
-    long value = ana_get_long(index)->value;
+    long value = ana_long_value(index);
 
     if(value >= 0 && value < self->len)
       return ana_stringfromstringandlen(self->value + value, 1);
@@ -343,12 +396,13 @@ static ana_object *string_less_than_or_equal(ana_object *strobj, ana_object *rig
 
 static ana_object *string_iterator_get(ana_object *obj)
 { 
-  obj->refcount++;
+  ana_incref(obj);
 
   ana_string_iterator *iter = malloc(sizeof(*iter));
 
   iter->base.flags = 0;
   iter->base.refcount = 0;
+  iter->base.is_tracked = 0;
   iter->base.type = &ana_string_iterator_type;
   iter->base.next = NULL;
 
@@ -374,7 +428,7 @@ static void string_iterator_dtor(ana_object *iterobj)
 { 
   ana_string_iterator *iter = (ana_string_iterator *)iterobj;
 
-  ana_get_base(iter->string)->refcount--;
+  ana_decref(ana_get_base(iter->string));
 
   free(iter);
 }
@@ -4,9 +4,11 @@
 #include <unistd.h>
 #include <stdio.h>
 
-ana_object *ana__builtin_readline(ana_object *args)
+ana_object *ana__builtin_readline(ana_object *self, ana_object **argv, int argc)
 {
-   COMO_UNUSED(args);
+   COMO_UNUSED(self);
+   COMO_UNUSED(argv);
+   COMO_UNUSED(argc);
 
     char *buffer = malloc(8);
     size_t buffersize = 8;
@@ -44,15 +46,17 @@ ana_object *ana__builtin_readline(ana_object *args)
     return retval;
 }
 
-ana_object *ana__builtin_print(ana_object *args)
+ana_object *ana__builtin_print(ana_object *self, ana_object **argv, int argc)
 {
-  ana_size_t i;
+  int i;
 
-  for(i = 0; i < ana_array_size(args); i++)
+  COMO_UNUSED(self);
+
+  for(i = 0; i < argc; i++)
   {
-    ana_object *value = ana_array_get(args, i); 
+    ana_object *value = argv[i]; 
    
-    assert(value->type->obj_print != NULL);
+    assert(ana_type_of(value)->obj_print != NULL);
 
     ana_object_print(value);
 
@@ -62,16 +66,18 @@ ana_object *ana__builtin_print(ana_object *args)
   return NULL;
 }
 
-ana_object *ana__builtin_int(ana_object *args)
+ana_object *ana__builtin_int(ana_object *self, ana_object **argv, int argc)
 {
-  if(ana_array_size(args) != 1)
+  COMO_UNUSED(self);
+
+  if(argc != 1)
   {
     Ana_SetError("ArgumentError", "int() expects exactly 1 argument");
 
     return NULL;
   }
 
-  ana_object *val = ana_get_array(args)->items[0];
+  ana_object *val = argv[0];
 
   if(ana_type_is(val, ana_string_type))
   {
@@ -119,18 +125,20 @@ ana_object *ana__builtin_int(ana_object *args)
   return NULL;
 } 
 
-ana_object *ana__builtin_typeof(ana_object *args)
+ana_object *ana__builtin_typeof(ana_object *self, ana_object **argv, int argc)
 {
   ana_object *arg;
 
-  if(ana_array_size(args) != 1)
+  COMO_UNUSED(self);
+
+  if(argc != 1)
   {
     Ana_SetError("ArgumentError", "typeof() expects exactly 1 argument");
 
     return NULL;
   }  
 
-  arg = ana_get_array(args)->items[0];
+  arg = argv[0];
 
   return ana_stringfromstring((char *)ana_type_name(arg));
 }
\ No newline at end of file
@@ -0,0 +1,1944 @@
+/* 
+ * The interpreter loop. This file is included twice by vm.c, once with
+ * ANA_FRAME_EVAL_TRACED set to 1 to build the variant that honours
+ * --opcodes and --live-tracing, and once with it set to 0 to build
+ * the variant without any tracing hooks.
+ */
+
+#undef TRACE
+#if defined(ANA_TRACE_DEBUG_ENABLED) && ANA_FRAME_EVAL_TRACED
+# define TRACE(op, strop, arg, flag, argused) \
+  TRACE_HOOK(op, strop, arg, flag, argused)
+#else
+# define TRACE(op, strop, arg, flag, argused)
+#endif
+
+static ana_object *ANA_FRAME_EVAL(ana_vm *vm)
+{
+  ana_frame *frame;
+  ana_uint32_t *jmptargets;
+  ana_object **constants;
+  ana_object *locals;
+
+  ana_object *arg = NULL, *retval = NULL, *left, *right, *result;
+
+#ifdef ANA_USE_COMPUTED_GOTO
+#include "opcode_targets.h"
+#endif
+
+  while(!COMO_VM_HAS_FRAMES())
+  {    
+    enter:
+    assert(vm->stackpointer > 0);
+    
+    frame = COMO_VM_POP_FRAME();
+    vm->base_frame = frame;
+
+    unsigned int *code = frame->code;
+    jmptargets = frame->jump_table;
+    constants = (ana_object **)(((ana_array *)vm->constants)->items);
+    locals = frame->locals;
+
+#if ANA_FRAME_EVAL_TRACED
+    if(vm->flags & COMO_VM_TRACING_ANY)
+      trace_frame(vm, frame);
+#endif
+
+    ana_uint32_t opline;
+    ana_uint32_t opcode;
+    short oparg;
+    unsigned opflag;
+
+    for(;;) {
+#ifndef ANA_USE_COMPUTED_GOTO
+      top:
+#endif
+      fetch();
+
+      vm_case(opcode) {
+        vm_default() {
+          Ana_SetError("VMError", "Opcode %#04x is not implemented", opcode);
+          vm_continue();
+        }
+        vm_target(IIMPORT)
+        {
+          ana_object *alias = pop();
+          ana_object *path = ana_array_get(vm->constants, (long)oparg);
+
+          if(import_file(vm, frame, alias, path) != 0)
+          {
+            vm_continue();
+          }
+          else
+          {
+            goto enter;
+          }
+        }        
+        vm_target(ITER) {
+          /* This is the container */
+          ana_object *iterable = pop();
+
+          /* the container is already part of the GC root*/
+
+          if(ana_type_of(iterable)->obj_iter == NULL)
+          {
+            set_except("TypeError", "%s object is not iterable",
+              ana_type_name(iterable));
+          }
+          else
+          {
+            ana_object *iterator = ana_type_of(iterable)->obj_iter(iterable);
+            
+            /* The iterator is tracked */
+            GC_TRACK(vm, iterator);
+
+            /* We must hold a reference to it because it will be 
+               reachable for the entire duration of this loop */
+            ana_incref(iterator);
+
+            push(iterator);
+
+          }
+
+          vm_continue();   
+        }
+        vm_target(ITER_MV) {          
+          ana_object *iterator = pop();
+          
+          assert(iterator);
+          assert(ana_type_of(iterator)->obj_iter_next != NULL);
+
+          ana_object *next = ana_type_of(iterator)->obj_iter_next(iterator);
+
+          if(!next)
+          {
+            frame->pc = jmptargets[oparg];
+            
+            /* release lock on the iterator */
+            ana_decref(iterator);
+
+            vm_dispatch();          
+          }
+          else
+          {
+            push(iterator);
+            push(next);
+          }
+
+          vm_continue();
+        }
+        vm_target(ILAND) {
+          ana_object *right = pop();
+          ana_object *left = pop();
+
+          if(!ana_type_of(left)->obj_bool(left))
+          {
+            /* This was falsy, so put this on the stack */
+            push(left);
+          }
+          else if(!ana_type_of(right)->obj_bool(right))
+          {
+            push(right);
+          }
+          else
+          {
+            push(right);
+          }
+
+          vm_continue();
+        }
+        vm_target(ILOR) {
+          // // operator, returns the first value that was true,
+          // else the right value is returned
+          //
+          ana_object *right = pop();
+          ana_object *left = pop();
+
+          /* left is true */
+          if(ana_type_of(left)->obj_bool(left))
+          {
+            push(left);
+
+            vm_continue();
+          }
+
+          if(ana_type_of(right)->obj_bool(right))
+          {
+            push(right);
+
+            vm_continue();
+          }   
+
+          push(right);
+
+          vm_continue();
+        }
+        vm_target(ILSHFT) {
+          ana_object *right = pop();
+          ana_object *left = pop();
+
+          if(ana_type_of(left)->obj_binops != NULL 
+            && ana_type_of(left)->obj_binops->obj_ls != NULL)
+          {
+            ana_object *res = ana_type_of(left)->obj_binops->obj_ls(left, right);
+
+            if(res)
+            {
+              push(res);
+            }
+          }
+          else
+          {
+
+            set_except("TypeError", "unsupported operands for << operator");
+          }
+
+          vm_continue();
+        }
+        vm_target(IRSHFT) {
+          ana_object *right = pop();
+          ana_object *left = pop();
+
+          if(ana_type_of(left)->obj_binops != NULL 
+            && ana_type_of(left)->obj_binops->obj_rs != NULL)
+          {
+            ana_object *res = ana_type_of(left)->obj_binops->obj_rs(left, right);
+
+            if(res)
+            {
+              push(res);
+            }
+          }
+          else
+          {
+
+            set_except("TypeError", "unsupported operands for >> operator");
+          }
+
+          vm_continue();
+        }
+        vm_target(IUNARYNOT) {
+          arg = pop();
+          
+          if(ana_type_of(arg)->obj_bool(arg) == 0)
+          {
+            push(ana_bool_true);
+          }
+          else
+          {
+            push(ana_bool_false);
+          }
+
+          vm_continue();
+        }
+        vm_target(IIN) {
+          ana_object *container = pop();
+          ana_object *index = pop();
+          ana_object *res = getindex(vm, container, index);
+
+          if(res)
+          {
+
+            push(res);
+          }
+
+          vm_continue();
+        }
+        vm_target(IUNARYMINUS) {
+          arg = pop();
+
+          if(ana_type_of(arg)->obj_unops != NULL 
+            && ana_type_of(arg)->obj_unops->obj_minus != NULL)
+          {
+            result = ana_type_of(arg)->obj_unops->obj_minus(arg);
+
+            if(result) 
+            {
+              GC_TRACK(vm, result);
+
+              push(result);
+            }
+            else
+              set_except("RuntimeError", "unsupported operand type for - operator");
+          }
+          else
+          {
+            set_except("RuntimeError", "unsupported operand type for - operator");
+          }
+
+          vm_continue();
+        }
+        vm_target(IUNARYPLUS) {
+          arg = pop();
+
+          if(ana_type_of(arg)->obj_unops != NULL 
+            && ana_type_of(arg)->obj_unops->obj_plus != NULL)
+          {
+            result = ana_type_of(arg)->obj_unops->obj_plus(arg);
+
+            if(result) {
+              GC_TRACK(vm, result);
+              push(result);
+            }
+            else
+              set_except("RuntimeError", "unsupported operand type for + operator");
+          }
+          else
+          {
+            set_except("RuntimeError", "unsupported operand type for + operator");
+          }
+
+          vm_continue();
+        }
+        vm_target(ITHROW) {
+          arg = pop();
+
+          ana_tostring_fast(arg, {
+            set_except("RuntimeError", "%s", value);
+          });
+
+          vm_continue();
+        }
+        vm_target(JMP) {
+          frame->pc = jmptargets[oparg];
+          vm_dispatch();
+        }
+        vm_target(JMPF) {
+          result = pop();
+          push(result);
+
+          if(ana_type_of(result)->obj_bool(result) == 0)
+          {     
+            frame->pc = jmptargets[oparg];
+            vm_dispatch();
+          }
+
+          vm_continue();
+        }
+        vm_target(JMPT) {
+          result = pop();
+          push(result);
+
+          if(ana_type_of(result)->obj_bool(result) != 0)
+          {     
+            frame->pc = jmptargets[oparg];
+            vm_dispatch();
+          }
+
+          vm_continue();
+        }
+        vm_target(JMPZ) {
+          result = pop();
+          
+          assert(result);
+
+          if(LIKELY(ana_type_is(result, ana_bool_type)))
+          {
+            if(!(((ana_bool *)result)->value))
+            {
+              frame->pc = jmptargets[oparg];
+              vm_dispatch();
+            }
+            else
+            {
+              goto done;
+            }
+          } 
+
+          if(ana_type_of(result)->obj_bool(result) == 0)
+          {     
+            frame->pc = jmptargets[oparg];
+            vm_dispatch();
+          }
+
+          done:
+          vm_continue();
+        }
+        vm_target(BEGIN_LOOP) {
+          assert(frame->loop_depth < COMO_BLOCK_STACK_MAX);
+
+          frame->loop_sp[frame->loop_depth++] = frame->sp;
+
+          vm_continue();
+        }
+        vm_target(EXIT_LOOP_CONTINUE) {       
+          /* values left on the stack by the statements of the loop body 
+             are dropped before the next iteration */
+          ana_size_t sp = frame->loop_sp[frame->loop_depth - 1];
+
+          if(frame->sp > sp)
+            frame->sp = sp;
+
+          vm_continue();
+        }
+        vm_target(END_LOOP) {
+          /* a break skips EXIT_LOOP_CONTINUE, so drop what it left too */
+          ana_size_t sp = frame->loop_sp[--frame->loop_depth];
+
+          if(frame->sp > sp)
+            frame->sp = sp;
+
+          vm_continue();
+        }
+        vm_target(SETUP_CATCH) {
+          int cindex = get_arg();
+                    
+          if(ex == NULL) 
+          {
+            assert(ana_excep != NULL);
+          }
+
+          arg = get_const(cindex);
+          
+          assert(arg != NULL);
+          
+          ana_object *exvalue = ana_stringfromstring(ex == NULL ? ana_excep : ex);
+          
+          GC_TRACK(vm, exvalue);
+          
+          ana_map_put(frame->locals, arg, exvalue);
+          
+          /* the message lives in preallocated storage, it's only cleared */
+          if(ex)
+          {
+            ex = NULL;
+            ex_type = NULL;
+          }
+          else
+          {
+            ana_excep = NULL;
+            ana_except_type = NULL;
+          }
+          
+          vm_continue();
+        }
+        vm_target(LOAD_SUBSCRIPT) {
+          ana_object *index = pop();
+          ana_object *container = pop();
+          ana_object *res = getindex(vm, container, index);
+
+          if(res == ANA_KEY_NOT_FOUND)
+          {
+            ana_tostring_fast(index, {
+              set_except("KeyError", "%s", value);
+            });
+          }
+          else if(res) 
+          {
+            push(res);
+          }
+          else
+          {
+            set_except("RuntimeError", "value does not support indexed access");
+          }
+
+          vm_continue(); 
+        }
+        vm_target(STORE_SUBSCRIPT) {
+          ana_object *value = pop();
+          ana_object *index = pop();
+          ana_object *container = pop();
+          ana_object *res = setindex(vm, container, index, value);
+          
+          if(res == ANA_KEY_NOT_FOUND)
+          {
+            set_except("KeyError", "index is out of range for assignment");
+          }
+          else if(!res)
+          {
+            set_except("RuntimeError", 
+              "indexed assignment is not supported for type '%s'", 
+              ana_type_name(container));
+          }
+          else
+          {
+            if(!opflag) 
+            {
+              push(res);
+            }
+          }
+
+          vm_continue();
+        }
+        vm_target(INITARRAY) {
+          int i;
+
+          result = ana_array_new(oparg);
+
+          /* The elements stay on the stack until the array is tracked, they 
+             aren't reference counted and a collection could free them */
+          for(i = 0; i < oparg; i++)
+          {
+            left = peek(i + 1);
+            
+            ana_array_push(result, left);
+          }
+
+          GC_TRACK(vm, result);
+
+          frame->sp -= oparg;
+
+          push(result);
+          
+          vm_continue();
+        }
+        vm_target(INITOBJ) {
+          int arg = get_arg();
+          int i;
+          ana_object *obj = ana_map_new(arg > 0 ? arg : 2);
+
+          /* Like INITARRAY, the pairs are popped only after tracking */
+          for(i = 0; i < arg; i++)
+          {
+            ana_object *val = peek(2 * i + 1);
+            ana_object *key = peek(2 * i + 2);
+
+            assert(ana_type_is(key, ana_string_type));
+
+            ana_map_put(obj, key, val);
+          }
+
+          GC_TRACK(vm, obj);
+
+          frame->sp -= 2 * arg;
+
+          push(obj);
+
+          vm_continue();
+        }
+        vm_target(SETPROP) {
+          arg = ana_array_get(vm->symbols, oparg);
+          assert(arg);
+          
+          ana_object *value = pop();          
+          ana_object *instance = pop();
+
+          if(ana_type_is(instance, ana_map_type))
+          {
+            ana_map_put(instance, arg, value);
+
+            GC_WRITE_BARRIER(vm, instance, value);
+            
+            if(!opflag)  
+            {              
+              push(value);
+            }
+
+            vm_continue();
+          }
+
+          /* prevent arbitrary properties from begin defined on non class types */
+          if(!ana_type_is(instance, ana_instance_type))
+          {
+            Ana_SetError(InvalidOperation, "Can't set property on object of type %s",
+              ana_type_name(instance));
+          } 
+          else  
+          {
+
+
+            //--- Begin chained resolution --------------------------
+            ana_instance *ins = ana_get_instance(instance);
+            ana_prop_cache *cache = prop_cache_at(frame);
+            ana_prop_cache_entry *entry = prop_cache_find(cache, ins);
+            ana_prop_cache_entry fill;
+            ana_object *res = value;
+
+            if(!entry)
+            {
+              entry = &fill;
+
+              instance_lookup(ins, arg, entry);
+
+              if(entry->value)
+              {
+                Ana_SetError(AnaTypeError, "Property `%s` is read-only", 
+                  ana_cstring(arg));
+                
+                vm_continue();
+              }
+
+              if(entry->owner < 0)
+              {
+                ana_instance_set_property(ins, arg, value);
+
+                entry->transition = ins->shape;
+              }
+
+              if(entry->klass)
+                prop_cache_add(cache, entry);
+            }
+            else if(entry->owner < 0)
+            {
+              ana_instance_set_shape(ins, entry->transition);
+
+              ins->values[entry->transition->nslots - 1] = value;
+            }
+
+            if(entry->owner >= 0)
+            {
+              ana_instance *owner = prop_cache_owner(entry, ins);
+
+              owner->values[entry->slot] = value;
+
+              GC_WRITE_BARRIER(vm, owner, value);
+            }
+            else
+            {
+              GC_WRITE_BARRIER(vm, ins, value);
+            }
+
+            //----------------------------------------------------
+            if(!opflag)
+              push(res);
+          } 
+          vm_continue();
+        }
+        vm_target(GETPROP) {
+          ana_object *instance = pop();
+          ana_object *res;
+          arg = ana_get_array(vm->symbols)->items[oparg];
+
+          res = getprop(vm, frame, instance, arg, 1);
+
+          if(res)
+            push(res);
+
+          vm_continue();
+        }
+        vm_target(LOAD_METHOD) {
+          ana_object *instance = pop();
+          ana_object *res;
+          arg = ana_get_array(vm->symbols)->items[oparg];
+
+          /* the receiver stays on the stack for CALL_METHOD, so 
+             methods are never bound here */
+          res = getprop(vm, frame, instance, arg, 0);
+
+          if(res) 
+          {
+            push(instance);
+            push(res);
+          }
+
+          vm_continue();
+        }
+        vm_target(IRETURN) {
+          /* this is for early return value binding, for class constructors instances */
+          if(frame->retval)
+          {
+            arg = frame->retval;
+          }
+          else
+          {
+            arg = pop();
+          }
+
+          if(!COMO_VM_HAS_FRAMES())
+          {
+            ana_frame *caller = vm->stack[vm->stackpointer - 1];
+            
+            frame->retval = arg;
+
+            pushto(caller, arg);
+          }
+                  
+          goto exit; 
+        }
+        vm_target(LOAD_CONST) {
+          arg = ana_array_get(vm->constants, oparg);
+          push(arg);
+          vm_continue();
+        }
+        vm_target(STORE_NAME) {
+
+          ana_object *thename = ana_array_get(vm->symbols, oparg);
+          result = pop();
+          ana_object *oldvalue = NULL;
+          ana_instance *ins = NULL;
+
+          if(frame->self)
+          {
+            assert(ana_type_is(frame->self, ana_instance_type));
+
+            ins = ana_get_instance(frame->self);
+
+            while(ins)
+            {
+              oldvalue = ana_map_get(ins->self->members, arg);
+
+              if(oldvalue)
+              {
+                Ana_SetError(AnaTypeError, "Property `%s` is read-only", 
+                  ana_cstring(arg));
+                
+                vm_continue();
+              }
+                
+              if(!oldvalue)
+              {
+                oldvalue = ana_instance_get_property(ins, arg);
+              }
+
+              if(oldvalue)
+              {
+                break;
+              }
+
+              ins = ana_get_instance(ins->base_instance);
+            }
+
+          }
+          else
+          {
+            oldvalue = ana_map_get(locals, thename);
+          }
+
+
+          /* only variables are counted, properties are traced through 
+             their instance */
+          if(!frame->self)
+          {
+            if(oldvalue)
+              ana_release(oldvalue);
+
+            ana_map_put(locals, thename, result);
+
+            ana_incref(result);
+          }
+          else
+          {
+            ana_instance_set_property(ana_get_instance(frame->self), thename, 
+              result);
+
+            GC_WRITE_BARRIER(vm, frame->self, result);
+          }
+
+          if(!opflag) 
+          {
+            push(result);
+          }
+
+          vm_continue();
+        }
+        vm_target(LOAD_NAME) {
+          ana_object *thename = ana_array_get(vm->symbols, oparg);
+
+          if(!frame->defn->name_cache)
+          {
+            frame->defn->name_cache = calloc(frame->defn->code_size, 
+              sizeof(ana_name_cache));
+          }
+
+          result = lookup_name_cached(frame, thename, 
+            &frame->defn->name_cache[frame->pc - 1]);
+
+          if(result) 
+          {
+            push(result);
+          }
+          else 
+          {
+            Ana_SetError(AnaNameError, "undefined variable '%s'", 
+              ana_cstring(thename));
+          }
+          
+          vm_continue();
+        }
+        vm_target(LOAD_FAST) {
+          result = frame->fastlocals[oparg];
+
+          if(!result)
+          {
+            /* not assigned yet in this call, it may name a global */
+            ana_object *thename = ana_array_get(frame->defn->local_names, 
+              oparg);
+
+            result = lookup_name(frame, thename);
+
+            if(!result)
+            {
+              Ana_SetError(AnaNameError, "undefined variable '%s'", 
+                ana_cstring(thename));
+
+              vm_continue();
+            }
+          }
+
+          push(result);
+          vm_continue();
+        }
+        vm_target(STORE_FAST) {
+          ana_object *oldvalue = frame->fastlocals[oparg];
+
+          result = pop();
+
+          if(oldvalue)
+          {
+            ana_release(oldvalue);
+          }
+
+          frame->fastlocals[oparg] = result;
+
+          ana_incref(result);
+
+          if(!opflag) 
+          {
+            push(result);
+          }
+
+          vm_continue();
+        }
+        vm_target(IDIV) {
+          right = pop();
+          left  = pop();
+
+          if(ana_type_check_both(left, right, ana_long_type))
+            quicken(IDIV_LL);
+          else if(ana_type_check_both(left, right, ana_double_type))
+            quicken(IDIV_DD);
+
+          result = do_div(vm, left, right);
+
+          if(result) {
+            push(result);
+          }
+          else
+            set_except("RuntimeError", "unsupported operands for / operator");
+          vm_continue();       
+        }
+        vm_target(IEQUAL) {
+          right = pop();
+          left  = pop();
+          result = NULL;
+
+          if(ana_type_of(left)->obj_compops != NULL 
+                && ana_type_of(left)->obj_compops->obj_eq != NULL)
+          {
+            /*
+              result does not need to be GC'd because it is an instance of 
+              bool 
+             */
+            result = ana_type_of(left)->obj_compops->obj_eq(left, right);
+            if(result)
+            {
+              push(result);
+            }
+          }
+          else
+          {
+            if(left == right)
+            {
+              push(ana_bool_true);
+            }
+            else
+            {
+              push(ana_bool_false);
+            }
+          }
+
+          vm_continue();
+        }
+        vm_target(INEQUAL) {
+          right = pop();
+          left  = pop();
+          result = NULL;
+
+          if(ana_type_of(left)->obj_compops != NULL 
+                && ana_type_of(left)->obj_compops->obj_neq != NULL)
+          {
+            /* this will return the singelton bool instance */
+            result = ana_type_of(left)->obj_compops->obj_neq(left, right);
+          }
+
+          if(result)
+          {
+            push(result);
+          }
+          else
+          {
+            if(left != right)
+            {
+              push(ana_bool_true);
+            }
+            else
+            {
+              push(ana_bool_false);
+            }
+          }
+
+          vm_continue();
+        }
+        vm_target(IREM) {
+          right = pop();
+          left  = pop();
+          result = NULL;
+
+          if(ana_type_check_both(left, right, ana_long_type))
+            quicken(IREM_LL);
+
+          if(ana_type_of(left)->obj_binops != NULL 
+                && ana_type_of(left)->obj_binops->obj_rem != NULL)
+          {
+            result = ana_type_of(left)->obj_binops->obj_rem(left, right);
+          }
+
+          if(result)
+          {
+            GC_TRACK(vm, result);
+
+            push(result);
+          }
+          else
+          {
+            set_except("NotImplementedError", "%% operation is not implemented"
+              "for type %s", ana_type_name(left));
+          }
+
+          vm_continue();
+        }  
+        vm_target(IADD) {
+
+          /* Here we have a reference to two objects that may
+             have been GC allocated */
+          right = pop();
+          left  = pop();
+
+          result = NULL;
+
+          if(ana_type_check_both(left, right, ana_long_type))
+          {
+            long val = ana_long_value(left) + ana_long_value(right);
+
+            quicken(IADD_LL);
+            
+            result = ana_longfromlong(val);
+          } 
+          else 
+          {
+            if(ana_type_check_both(left, right, ana_double_type))
+              quicken(IADD_DD);
+
+            if(ana_type_of(left)->obj_binops != NULL 
+              && ana_type_of(left)->obj_binops->obj_add != NULL) 
+                result = ana_type_of(left)->obj_binops->obj_add(left, right);
+          }
+
+          if(result) 
+          {
+            /* what happens here, is that we've pushed an 
+               object onto the stack, then call GC, 
+               this will mark the current object, but we need it later on
+            */
+            GC_TRACK(vm, result);
+            /* GC_TRACK may run the GC, then add this object to the root
+               it's important that the push happens after, since push
+                increases the stack pointer 
+             */
+            push(result);
+          }
+          else
+            set_except("RuntimeError", "unsupported operands for + operator");
+          
+          vm_continue();
+        }
+        vm_target(ILT) {
+          right = pop();
+          left  = pop();
+
+          result = NULL;
+
+          if(ana_type_check_both(left, right, ana_long_type))
+          {
+            quicken(ILT_LL);
+
+            if(ana_long_value(left) < ana_long_value(right))
+              result = ana_bool_true;
+            else
+              result = ana_bool_false;    
+
+            push(result);
+          }
+          else if(ana_type_of(left)->obj_compops != NULL 
+              && ana_type_of(left)->obj_compops->obj_lt != NULL) 
+          {
+            /* this is just a boolean which only exists in a singleton */
+            /* do not add to GC */
+            result = ana_type_of(left)->obj_compops->obj_lt(left, right);
+            
+            if(result) 
+            {
+              push(result);
+            }
+
+            vm_continue();
+          }
+          else
+          {
+            set_except("TypeError", "unsupported operands for < operator");
+          }
+
+          vm_continue(); 
+        }
+        vm_target(IGT) {
+          right = pop();
+          left  = pop();
+
+          result = NULL;
+
+          if(ana_type_check_both(left, right, ana_long_type))
+          {
+            quicken(IGT_LL);
+
+            if(ana_long_value(left) > ana_long_value(right))
+              result = ana_bool_true;
+            else
+              result = ana_bool_false; 
+
+            push(result);
+          }
+          else if(ana_type_of(left)->obj_compops != NULL 
+              && ana_type_of(left)->obj_compops->obj_lt != NULL) 
+          {
+            /* this is just a boolean which only exists in a singleton */
+            /* do not add to GC */
+            result = ana_type_of(left)->obj_compops->obj_lt(left, right);
+
+            if(result)
+            {
+              push(result);
+            }
+
+            vm_continue();
+          }
+          else
+          {
+            set_except("TypeError", "unsupported operands for < operator");
+          }
+
+          vm_continue(); 
+        }
+        vm_target(ILTE) {
+          right = pop();
+          left  = pop();
+
+          result = NULL;
+
+          if(ana_type_check_both(left, right, ana_long_type))
+          {
+            quicken(ILTE_LL);
+
+            if(ana_long_value(left) <= ana_long_value(right))
+              result = ana_bool_true;
+            else
+              result = ana_bool_false;    
+
+            push(result);
+          }
+          else if(ana_type_of(left)->obj_compops != NULL 
+              && ana_type_of(left)->obj_compops->obj_lte != NULL) 
+          {
+            /* this is just a boolean which only exists in a singleton */
+            /* do not add to GC */
+            result = ana_type_of(left)->obj_compops->obj_lte(left, right);
+
+            if(result) 
+            {
+              /* bool objects aren't GC'd, there are only 2 instances throught 
+                 the entire run 
+               */
+              push(result);
+            }
+          }
+          else 
+          {
+            set_except("RuntimeError", "unsupported operands for <= operator");
+          }
+
+          vm_continue(); 
+        }
+        vm_target(IGTE) {
+          right = pop();
+          left  = pop();
+
+          result = NULL;
+
+          if(ana_type_check_both(left, right, ana_long_type))
+          {
+            quicken(IGTE_LL);
+
+            if(ana_long_value(left) >= ana_long_value(right))
+              result = ana_bool_true;
+            else
+              result = ana_bool_false;
+
+            push(result);
+          }
+          else if(ana_type_of(left)->obj_compops != NULL 
+              && ana_type_of(left)->obj_compops->obj_lte != NULL) 
+          {
+            /* this is just a boolean which only exists in a singleton */
+            /* do not add to GC */
+            result = ana_type_of(left)->obj_compops->obj_gte(left, right);
+
+            if(result)
+            {
+              push(result);
+            }
+          }
+          else 
+          {
+            set_except("RuntimeError", "unsupported operands for >= operator");
+          }
+
+          vm_continue();
+        }
+        vm_target(ITIMES) {
+          right = pop();
+          left  = pop();
+
+          if(ana_type_check_both(left, right, ana_long_type))
+            quicken(ITIMES_LL);
+          else if(ana_type_check_both(left, right, ana_double_type))
+            quicken(ITIMES_DD);
+
+          result = mul(vm, left, right);
+
+          if(result) 
+          {
+            push(result);
+          }
+          else
+            set_except("RuntimeError", "unsupported operands for * operator");
+
+          vm_continue();
+        }
+        vm_target(IMINUS) {
+          right = pop();
+          left  = pop();
+
+          if(ana_type_check_both(left, right, ana_long_type))
+            quicken(IMINUS_LL);
+          else if(ana_type_check_both(left, right, ana_double_type))
+            quicken(IMINUS_DD);
+
+          result = sub(vm, left, right);
+
+          if(result) 
+          {
+            push(result);
+          }
+          else
+            set_except("RuntimeError", "unsupported operands for - operator");
+
+          vm_continue();
+        }
+        /* 
+         * Specialized variants written over the generic opcodes above once
+         * they have seen operands of a single type. The operands are only 
+         * popped after the guard holds, otherwise the instruction is 
+         * rewritten back to the generic opcode and executed again.
+         */
+        vm_target(IADD_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type)))
+            deoptimize(IADD);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_longfromlong(
+            ana_long_value(left) + ana_long_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(IMINUS_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type)))
+            deoptimize(IMINUS);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_longfromlong(
+            ana_long_value(left) - ana_long_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(ITIMES_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type)))
+            deoptimize(ITIMES);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_longfromlong(
+            ana_long_value(left) * ana_long_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(IDIV_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type) 
+            || ana_long_value(right) == 0))
+            deoptimize(IDIV);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_longfromlong(
+            ana_long_value(left) / ana_long_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(IREM_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type) 
+            || ana_long_value(right) == 0))
+            deoptimize(IREM);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_longfromlong(
+            ana_long_value(left) % ana_long_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(ILT_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type)))
+            deoptimize(ILT);
+
+          right = pop();
+          left  = pop();
+
+          if(ana_long_value(left) < ana_long_value(right))
+            push(ana_bool_true);
+          else
+            push(ana_bool_false);
+
+          vm_continue();
+        }
+        vm_target(IGT_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type)))
+            deoptimize(IGT);
+
+          right = pop();
+          left  = pop();
+
+          if(ana_long_value(left) > ana_long_value(right))
+            push(ana_bool_true);
+          else
+            push(ana_bool_false);
+
+          vm_continue();
+        }
+        vm_target(ILTE_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type)))
+            deoptimize(ILTE);
+
+          right = pop();
+          left  = pop();
+
+          if(ana_long_value(left) <= ana_long_value(right))
+            push(ana_bool_true);
+          else
+            push(ana_bool_false);
+
+          vm_continue();
+        }
+        vm_target(IGTE_LL) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_long_type)))
+            deoptimize(IGTE);
+
+          right = pop();
+          left  = pop();
+
+          if(ana_long_value(left) >= ana_long_value(right))
+            push(ana_bool_true);
+          else
+            push(ana_bool_false);
+
+          vm_continue();
+        }
+        vm_target(IADD_DD) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_double_type)))
+            deoptimize(IADD);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_doublefromdouble(
+            ana_double_value(left) + ana_double_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(IMINUS_DD) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_double_type)))
+            deoptimize(IMINUS);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_doublefromdouble(
+            ana_double_value(left) - ana_double_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(ITIMES_DD) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_double_type)))
+            deoptimize(ITIMES);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_doublefromdouble(
+            ana_double_value(left) * ana_double_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(IDIV_DD) {
+          right = peek(1);
+          left  = peek(2);
+
+          if(UNLIKELY(!ana_type_check_both(left, right, ana_double_type)))
+            deoptimize(IDIV);
+
+          right = pop();
+          left  = pop();
+
+          result = ana_doublefromdouble(
+            ana_double_value(left) / ana_double_value(right));
+
+          GC_TRACK(vm, result);
+
+          push(result);
+
+          vm_continue();
+        }
+        vm_target(DEFINE_CLASS) {
+          ana_object *baseclass = NULL;
+
+          if(opflag)
+          {
+            baseclass = pop();
+          }
+
+          ana_object *name = pop();
+          ana_object *fncount = pop();
+          ana_class *theclass = (ana_class *)ana_class_new(baseclass, name);
+          long i = ana_long_value(fncount);
+
+          while(i--)
+          {
+            ana_object *function_name = pop();
+            ana_object *function_code = pop();
+
+            ana_map_put(theclass->members, function_name, function_code);
+          }
+
+          ana_object *prev;
+
+          if((prev = ana_map_get(frame->locals, name)) != NULL)
+          {
+            ana_release(prev);
+          }
+
+          ana_map_put(frame->locals, name, (ana_object *)theclass);
+
+          ana_incref(ana_get_base(theclass));
+
+          GC_TRACK(vm, theclass);
+
+          vm_continue();
+        }
+        vm_target(DEFINE_FUNCTION) {
+          ana_object *name = pop();
+          ana_object *fn = pop();
+          ana_map_put(frame->locals, name, fn);
+          vm_continue();
+        }
+        vm_target(CALL_METHOD) {
+          ana_object *res = NULL;
+          ana_object *callable = pop();
+          ana_object *self = pop();
+          
+          int totalargs = oparg;
+
+          if(ana_type_is(callable, ana_function_type))
+          {
+            ana_function *func = ana_get_function(callable);
+
+            if((ana_get_function(callable)->flags & COMO_FUNCTION_LANG) 
+                == COMO_FUNCTION_LANG)
+            {
+              int totalargs = oparg;
+              ana_function *fn = ana_get_function(callable);
+        
+              struct _ana_function_def *call = fn->func;
+
+              ana_frame *execframe = ana_frame_new(
+                vm,
+                call,
+                BASE_FRAME->locals,
+                fn->name, 
+                frame,
+                frame->filename
+              );
+
+
+              if(setup_args(vm, frame, execframe, fn, totalargs) != 0)
+              {
+                ana_object_dtor(execframe);
+                vm_continue();
+              }
+
+              /* Make sure this isn't a module funciton */
+              if(ana_type_is(self, ana_instance_type))
+              {
+                /* figure out if this is the base or parent */
+                /* base instnace being null would mean this is the parent class
+                   , so this must be the child 
+                */
+
+                ana_instance *i = ana_get_instance(self);
+                ana_object *real_self = self;
+                ana_prop_cache *cache = prop_cache_at(frame);
+                ana_prop_cache_entry *entry = NULL;
+                int k;
+
+                /* the instance that defines the method only depends on the
+                   class of the receiver */
+                for(k = 0; k < cache->count; k++)
+                {
+                  if(cache->entries[k].klass == i->self 
+                    && cache->entries[k].value == callable)
+                  {
+                    entry = &cache->entries[k];
+                    break;
+                  }
+                }
+
+                if(entry)
+                {
+                  i = prop_cache_owner(entry, i);
+                  real_self = (ana_object *)i;
+                }
+                else
+                {
+                  ana_prop_cache_entry fill;
+
+                  fill.klass = i->self;
+                  fill.value = callable;
+                  fill.nshapes = 0;
+                  fill.owner = 0;
+                  fill.slot = -1;
+                  fill.transition = NULL;
+
+                  while(i)
+                  {                
+                    if(ana_map_get(i->self->members, fn->name) != NULL)
+                    {
+                      real_self = (ana_object *)i;
+                      prop_cache_add(cache, &fill);
+                      break;
+                    }
+
+                    i = ana_get_instance(i->base_instance);
+                    fill.owner++;
+                  }
+                }
+
+                if(ana_get_instance(real_self)->base_instance != NULL)
+                  ana_map_put(execframe->locals, 
+                    vm->base_symbol, ana_get_instance(real_self)->base_instance);
+
+                ana_map_put(execframe->locals, 
+                  vm->self_symbol, real_self);
+
+                execframe->self = real_self;
+                ana_get_instance(execframe->self)->module= i->module;
+              }
+              
+              if(ana_type_is(self, ana_module_type))
+              {
+                execframe->module = ana_get_module(self);
+              }
+
+              COMO_VM_PUSH_FRAME(frame);
+              COMO_VM_PUSH_FRAME(execframe);
+
+              goto enter;            
+            }
+            else if( (ana_get_function(callable)->flags 
+                & COMO_FUNCTION_NATIVE_METHOD) == COMO_FUNCTION_NATIVE_METHOD)
+            {
+              if(ana_array_size(ana_get_function(callable)->method.m_parameters) 
+                  != (ana_size_t)totalargs)
+              {
+                 Ana_SetError(AnaArgumentError, "%s expects %ld argument(s), %d given",
+                  ana_cstring(ana_get_function(callable)->name), 
+                  ana_array_size(ana_get_function(callable)->method.m_parameters),
+                  totalargs);      
+
+                vm_continue();
+              }
+
+              ana_object **argv = &frame->stack[frame->sp - totalargs];
+
+              res = ana_get_function(callable)->method.m_handler(self, argv, 
+                totalargs);
+
+              frame->sp -= totalargs;
+
+              /* a native method can store its arguments in its receiver */
+              if(self && !ana_is_immortal(self))
+                GC_WRITTEN(vm, self);
+              
+              /* TODO flag to check if it's already tracked */
+              /* this value may already be tracked */
+              if(oparg > 0)
+              {
+                /* TODO Check to make sure the returned value is not an argument */
+                /* because the arguments on the stack may either be constants
+                   or already part of the GC root 
+                */
+                int found_reflected = 0;
+                int i;
+                for(i = 0; i < oparg; i++)
+                {
+                  /* To do this is single dimensional, will have bugs later */
+                  if(res == argv[i])
+                  {
+                    found_reflected = 1;
+                    break;
+                  }
+                }
+
+                if(!found_reflected) 
+                {
+                  if(!ana_is_immortal(res) && !res->is_tracked) 
+                  {
+                    GC_TRACK_DIMENSIONAL(vm, res);
+                  }
+                  //GC_TRACK(vm, res);
+                }
+              }
+              else
+              {
+                /* If this is already tracked this can be a bug */
+                /* for example:
+                 *
+                 * a search method, which takes a key and returns a value in an array
+                   that was already tracked, here we would track it twice.
+                   TODO make a flag where we say if it is already tracked
+                 */
+
+                /* is_this_tracked? */
+                
+                if(!ana_is_immortal(res) && !res->is_tracked)
+                {
+                  GC_TRACK_DIMENSIONAL(vm, res);
+                }
+
+                //GC_TRACK(vm, res);
+              }
+
+              if(res)
+              {
+                push(res);
+              }
+            }
+            else if( (ana_get_function(callable)->flags & COMO_FUNCTION_NATIVE)
+              == COMO_FUNCTION_NATIVE)
+            {
+              /* this is a just a native function wrapper into a variable */
+            
+              ana_object *res = func->handler(self, 
+                &frame->stack[frame->sp - totalargs], totalargs); 
+
+              frame->sp -= totalargs;
+
+              if(res) 
+              {
+                GC_TRACK(vm, res);
+              }
+            }
+          }
+          else if(ana_type_is(callable, ana_class_type))
+          {
+            /* This happens on a class property assign to a class */
+            if(invoke_class(vm, callable, totalargs, frame, self) == 0)
+            {
+              vm_continue();
+            }
+            else
+            {
+              goto enter;
+            }
+          }
+          else
+          {
+            Ana_SetError(InvalidOperation, "Cannot call object of type `%s`",
+              ana_type_name(callable));
+
+            vm_continue();
+          }
+
+          vm_continue();
+        }
+        /* falls through to CALL when the frame can't be reused */
+        vm_target(TAILCALL) {
+          if(tail_call(vm, frame, oparg) == 0)
+          {
+            COMO_VM_PUSH_FRAME(frame);
+
+            goto enter;
+          }
+        }
+        vm_target(CALL) {
+          ana_object *res = NULL;
+          ana_object *callable = pop();
+          ana_object *self = NULL;
+
+          if(ana_type_is(callable, ana_function_type) || 
+                ana_type_is(callable, ana_bounded_function_type)) 
+          {
+            if(invoke_function(vm, self, callable, oparg, frame) != 0)
+              vm_continue();
+            else
+              goto enter;
+          }
+          else if(ana_type_is(callable, ana_class_type))
+          {
+            /* This happens on a class property assign to a class */
+            if(invoke_class(vm, callable, (int)oparg, frame, NULL) == 0)
+            {
+              vm_continue();
+            }
+            else
+            {
+              goto enter;
+            }
+          }
+          else if(ana_type_is(callable, ana_instance_type))
+          {
+            // this will happen when a method calls base()
+            int totalargs = oparg;
+            ana_instance *instance = ana_get_instance(callable);
+            ana_class *class_defn = instance->self; 
+            ana_object *instance_name = class_defn->name;
+            ana_object *constructor = NULL;
+            /* ensure that base constructors are only called from 
+               child constructors
+            */
+            if(frame->self != NULL)
+            {
+              assert(ana_type_is(frame->self, ana_instance_type));
+
+              /* todo all base constructors need to be called */
+              constructor = ana_map_get(class_defn->members, instance_name);
+
+              if(constructor == NULL)
+              {
+                goto no_constructor_found;
+              }      
+
+              ana_instance *current_instance = ana_get_instance(frame->self);
+
+              /* prevent instances from being called outside
+                 constructors (e.g. in class methods)
+               */
+              if(!ana_object_equals(current_instance->self->name, frame->name))
+              {
+                Ana_SetError(InvalidOperation, 
+                  "Illegal invocation of %s.%s outside of %s.%s", 
+                   ana_cstring(instance_name),
+                   ana_cstring(instance_name),
+                   ana_cstring(ana_get_instance(frame->self)->self->name),
+                   ana_cstring(ana_get_instance(frame->self)->self->name)
+                );
+
+                goto call_exit;
+              }
+
+              /* Now we are sure this instance is being called inside a class constructor, but we now must check that this call is legal
+                 e.g. no passing instances to other classes */
+
+              /* perhaps, an instance won't be called in a constructor if it doesn't have a base */
+
+              if(current_instance->base_instance == NULL)
+              {
+                Ana_SetError(InvalidOperation, 
+                  "Illegal invocation of instance `%s`", ana_cstring(instance_name)
+                );
+
+                goto call_exit;               
+              }
+
+              /* Now check that this target instance call is an immediate parent of this current instance */
+
+              ana_instance *parent_instance = (ana_instance *)current_instance->base_instance;
+
+              if(!ana_object_equals(parent_instance->self->name, instance->self->name))
+              {
+                 Ana_SetError(InvalidOperation, 
+                  "Illegal invocation of instance `%s`, as it's not an immediate parent of `%s`", 
+                  ana_cstring(instance_name),
+                  ana_cstring(current_instance->self->name)
+                );
+
+                goto call_exit;
+              }
+
+
+              if(constructor == NULL)
+              {
+                no_constructor_found:
+                Ana_SetError(AnaTypeError, 
+                  "constructor for class %s is not defined", 
+                  ana_cstring(class_defn->name));   
+
+                goto call_exit;            
+              }
+              else
+              {
+                ana_function *c_func = ana_get_function(constructor);
+                ana_function_defn *c_func_def = c_func->func;
+        
+                ana_frame *execframe = ana_frame_new(
+                  vm,
+                  c_func_def,
+                  BASE_FRAME->locals,
+                  c_func->name, 
+                  frame,
+                  frame->filename
+                );
+
+                ana_map_put(execframe->locals, 
+                  vm->self_symbol, (ana_object *)instance);
+
+                if(c_func_def->parameters != NULL)
+                {
+                  if(ana_get_array(c_func_def->parameters)->size != totalargs)
+                  {
+                    Ana_SetError(
+                      AnaArgumentError, "%s expects %lu argument(s), %d given",
+                      ana_get_fn_name(execframe), 
+                      ana_get_array(c_func_def->parameters)->size,
+                      totalargs);
+                    
+                    goto call_exit;
+                  }
+                }
+                else if(totalargs != 0)
+                {
+                  Ana_SetError(
+                    AnaArgumentError, "%s expects 0 argument(s), %d given",
+                    ana_get_fn_name(execframe), totalargs);
+
+                  goto call_exit;
+                }
+
+                while(totalargs--)
+                {
+                  ana_object *theargvalue = pop();
+
+                  ana_incref(theargvalue);
+
+                  store_arg(execframe, c_func_def, (ana_size_t)totalargs, 
+                    theargvalue);
+                }
+
+                /* TODO, if there is a base instance, put this in 
+                   as "base" variable 
+                */
+                execframe->self = (ana_object *)instance;
+
+                COMO_VM_PUSH_FRAME(frame);
+                COMO_VM_PUSH_FRAME(execframe);
+
+                goto enter;
+              }
+            }
+            else
+            {
+              Ana_SetError(InvalidOperation, 
+                "Can't call instance type outside of a class constructor");
+            }
+          }
+          else
+          { 
+            Ana_SetError(InvalidOperation, "Cannot call object of type `%s`",
+              ana_type_name(callable));
+
+            goto call_exit;
+          }
+
+          if(res)
+            push(res);
+
+          call_exit:
+          vm_continue();
+        }
+      }
+
+      vm_next:
+      if(ex || ana_excep) 
+      {
+        char *the_message = ex ==  NULL ? ana_excep : ex;
+        char *the_type = ex_type == NULL ? ana_except_type : ex_type;
+
+        ana_frame *thisframe = frame;
+        ana_size_t below = vm->stackpointer;
+        ana_exception_handler *handler = NULL;
+
+        /* the frame that threw, then the frames waiting on it */
+        for(;;)
+        {
+          if(thisframe->pc > 0)
+            handler = ana_function_defn_findhandler(thisframe->defn, 
+              thisframe->pc - 1);
+
+          if(handler || below == 0)
+            break;
+
+          thisframe = vm->stack[--below];
+        }
+
+        if(handler)
+        {
+          /* frames above the handler's won't be returned to */
+          if(thisframe != frame)
+          {
+            discard_frame(vm, frame);
+
+            while(vm->stackpointer > below + 1)
+              discard_frame(vm, COMO_VM_POP_FRAME());
+
+            (void)COMO_VM_POP_FRAME();
+          }
+
+          thisframe->pc = handler->handler;
+          thisframe->loop_depth = handler->loop_depth;
+
+          while(thisframe->sp > handler->sp)
+            ana_release(thisframe->stack[--thisframe->sp]);
+
+          if(!(thisframe->flags & COMO_FRAME_OWNS_STACK))
+            vm->value_stack_top = thisframe->stack + thisframe->sz;
+
+          COMO_VM_PUSH_FRAME(thisframe);
+
+          goto enter; 
+        }
+
+        int current_line = ana_frame_getline(frame);
+
+        ana_object *filename;    
+
+        if(frame->self && ana_get_instance(frame->self)->module)
+        {
+          filename = ana_get_module(ana_get_instance(frame->self)->module)->filename;
+        }
+        else
+        {
+          filename = frame->filename;
+        } 
+            
+        fprintf(stdout, "%s: %s\n    in %s:%d\n", 
+          the_type, 
+          the_message, 
+          ana_cstring(filename), 
+          current_line
+        );
+
+        ana_print_backtrace(frame);
+      
+        exit(1);
+      }
+    }
+
+    exit:
+    while(!empty()) 
+    {
+      ana_object *temp = pop();
+
+      assert(temp);
+
+      ana_release(temp);
+    }
+
+    release_locals(frame);
+    
+    ana_object_finalize(frame);
+    ana_object_dtor(frame);
+    vm->base_frame = NULL;
+  }
+
+  return retval;
+}
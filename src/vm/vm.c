@@ -10,6 +10,8 @@
 
 #include <stdio.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "ana.h"
 #include "vm.h"
@@ -26,8 +28,7 @@
 static void trace_frame(ana_vm *vm, ana_frame *frame);
 static void ana_print_backtrace(ana_frame *frame);
 static void gc(ana_vm *vm);
-static void decref_recursively(ana_object *obj);
-static void incref_recursively(ana_object *obj);
+static void collect(ana_vm *vm);
 
 static ana_frame *BASE_FRAME;
 static ana_vm *AnaVM = NULL;
@@ -39,31 +40,65 @@ ana_vm *ana_vm_location(void)
   return AnaVM;
 }
 
+/* Only one exception is pending at a time, so its message has a home */
+static char except_storage[ANA_EXCEPTION_MESSAGE_MAX];
+
 static char *make_except(const char *fmt, ...)
 {
-  char *buffer = NULL;
-  int size = 1024;
   va_list args;
   va_start (args, fmt);
-  buffer = malloc(size + 1);
-  vsnprintf(buffer, size, fmt, args);
+  vsnprintf(except_storage, sizeof(except_storage), fmt, args);
   va_end (args);
-  return buffer;
+  return except_storage;
 }
 
 char *ex = NULL;
 char *ex_type = NULL;
 
+/* The only check on a push is whether the stack is full or too deep */
 #define COMO_VM_PUSH_FRAME(frame) do { \
-  if(vm->stackpointer >= COMO_VM_STACK_MAX) { \
-    set_except("RuntimeError", "max call stack size reached, max frame stack size is %d", \
-      COMO_VM_STACK_MAX); \
-  } \
+  if(vm->stackpointer >= vm->stacklimit) \
+    grow_frame_stack(vm); \
   vm->stack[vm->stackpointer++] = frame; \
   ana_get_base(frame)->next = (ana_object *)vm->frameroot; \
   vm->frameroot = ana_get_base(frame); \
 } while(0)
 
+/* 
+ * Grows the frame stack by a chunk, up to max_stack_depth. A push at or 
+ * past it raises the RuntimeError, the frame goes in a reserve of one 
+ * chunk past the limit, allocated the first time, where the frames pushed
+ * before it unwinds have room
+ */
+static void grow_frame_stack(ana_vm *vm)
+{
+  ana_size_t newsize;
+
+  if(vm->stackpointer >= vm->max_stack_depth)
+  {
+    set_except("RuntimeError", 
+      "max call stack size reached, max frame stack size is %lu",
+      (unsigned long)vm->max_stack_depth);
+
+    if(vm->stackpointer < vm->stacksize)
+      return;
+
+    newsize = vm->stackpointer + COMO_VM_STACK_CHUNK;
+  }
+  else
+  {
+    newsize = vm->stacksize + COMO_VM_STACK_CHUNK;
+
+    if(newsize > vm->max_stack_depth)
+      newsize = vm->max_stack_depth;
+  }
+
+  vm->stack = realloc(vm->stack, sizeof(ana_frame *) * newsize);
+  vm->stacksize = newsize;
+  vm->stacklimit = newsize < vm->max_stack_depth 
+    ? newsize : vm->max_stack_depth;
+}
+
 #define COMO_VM_POP_FRAME() \
   vm->stack[--vm->stackpointer]
 
@@ -73,24 +108,50 @@ char *ex_type = NULL;
 
 // #define ANA_GC_DEBUG1 0
 // #define ANA_GC_DEBUG 0
-#define ANA_GC_OBJ_THRES 16
+#define ANA_GC_NURSERY_SIZE (1 << 12)  /* young objects per minor collection */
+#define ANA_GC_OLD_THRES (1 << 14)     /* least old objects for a major one */
+#define ANA_GC_STEP (1 << 8)           /* allocations between incremental slices */
+#define ANA_GC_ARRAY_CHUNK (1 << 8)    /* array items traced at a time */
+#define ANA_GC_PREFETCH 8              /* array items fetched ahead of marking */
+#define ANA_GC_DEQUE_SIZE (1 << 10)    /* a marking thread's deque to start */
+#define ANA_GC_SPINS 16                /* yields of an idle marking thread */
 
 ana_vm *ana_vm_new()
 {  
   ana_vm *vm = malloc(sizeof(ana_vm));
-  ana_size_t i;
 
-  for(i = 0; i < COMO_VM_STACK_MAX; i++)
-    vm->stack[i] = NULL;
-
-  vm->stacksize = 0;
+  vm->stack = malloc(sizeof(ana_frame *) * COMO_VM_STACK_CHUNK);
+  vm->stacksize = COMO_VM_STACK_CHUNK;
+  vm->stacklimit = COMO_VM_STACK_CHUNK;
   vm->stackpointer = 0;
+  vm->max_stack_depth = COMO_VM_STACK_MAX;
+  vm->value_stack = malloc(sizeof(ana_object *) * COMO_VM_VALUE_STACK_SIZE);
+  vm->value_stack_top = vm->value_stack;
+  vm->value_stack_end = vm->value_stack + COMO_VM_VALUE_STACK_SIZE;
+  vm->frame_pool = NULL;
+  vm->frame_pool_size = 0;
   vm->exception = NULL;
   vm->flags = 0;
   vm->nobjs = 0;
-  vm->do_gc = gc;
-  vm->mxobjs = ANA_GC_OBJ_THRES;
+  vm->do_gc = collect;
+  vm->mxobjs = ANA_GC_NURSERY_SIZE;
   vm->root = NULL;
+  vm->old = NULL;
+  vm->nold = 0;
+  vm->mxold = ANA_GC_OLD_THRES;
+  vm->remembered = NULL;
+  vm->nremembered = 0;
+  vm->remembered_capacity = 0;
+  vm->gc_skip = ANA_GC_MARKED;
+  vm->gc_state = ANA_GC_IDLE;
+  vm->gc_pause = 0;
+  vm->gray = NULL;
+  vm->ngray = 0;
+  vm->gray_capacity = 0;
+  vm->gc_cursor = NULL;
+  vm->gc_sweeping = NULL;
+  vm->gc_sweep_at = NULL;
+  vm->gc_threads = 1;
   vm->symbols   = ana_array_new(8);
   vm->constants = ana_array_new(16);
   vm->self_symbol = ana_stringfromstring("self");
@@ -112,6 +173,24 @@ ana_vm *ana_vm_new()
   return vm;
 }
 
+/* Limits how deep calls can nest, the frame stack grows past it only by
+   the reserve a RuntimeError unwinds in */
+void ana_vm_set_max_stack_depth(ana_vm *vm, ana_size_t depth)
+{
+  if(depth == 0)
+    depth = 1;
+
+  vm->max_stack_depth = depth;
+
+  if(vm->stacksize > depth && vm->stackpointer <= depth)
+  {
+    vm->stack = realloc(vm->stack, sizeof(ana_frame *) * depth);
+    vm->stacksize = depth;
+  }
+
+  vm->stacklimit = vm->stacksize < depth ? vm->stacksize : depth;
+}
+
 void ana_vm_finalize(ana_vm *vm)
 {
   ana_array_foreach_apply(vm->symbols, ana_object_dtor);
@@ -127,7 +206,12 @@ void ana_vm_finalize(ana_vm *vm)
   ana_array_type_finalize(vm);
   ana_string_type_finalize(vm);
   ana_long_type_finalize(vm);
+  ana_frame_type_finalize(vm);
 
+  free(vm->stack);
+  free(vm->value_stack);
+  free(vm->remembered);
+  free(vm->gray);
   free(vm);
 }
 
@@ -140,6 +224,56 @@ ana_object *ana_vm_new_symbol(ana_vm *vm, char *symbol)
   return thesymbol;
 }
 
+/* Major collections mark and sweep in slices of at most usecs, 0 runs 
+   them to completion */
+void ana_vm_set_gc_pause(ana_vm *vm, ana_size_t usecs)
+{
+  vm->gc_pause = usecs;
+}
+
+/* Full collections that stop the program are marked by nthreads threads,
+   the program's own among them */
+void ana_vm_set_gc_threads(ana_vm *vm, int nthreads)
+{
+  vm->gc_threads = nthreads > 1 ? nthreads : 1;
+}
+
+static void gray_push(ana_vm *vm, ana_object *obj)
+{
+  if(vm->ngray == vm->gray_capacity)
+  {
+    vm->gray_capacity = vm->gray_capacity ? vm->gray_capacity * 2 : 256;
+    vm->gray = realloc(vm->gray, sizeof(ana_object *) * vm->gray_capacity);
+  }
+
+  obj->flags |= ANA_GC_GRAY;
+  vm->gray[vm->ngray++] = obj;
+}
+
+/* Called through GC_WRITTEN, obj was just given a value */
+void ana_vm_write_barrier(ana_vm *vm, ana_object *obj)
+{
+  if((obj->flags & (ANA_GC_OLD | ANA_GC_REMEMBERED)) == ANA_GC_OLD)
+  {
+    if(vm->nremembered == vm->remembered_capacity)
+    {
+      vm->remembered_capacity = vm->remembered_capacity 
+        ? vm->remembered_capacity * 2 : 64;
+      vm->remembered = realloc(vm->remembered, 
+        sizeof(ana_object *) * vm->remembered_capacity);
+    }
+
+    obj->flags |= ANA_GC_REMEMBERED;
+    vm->remembered[vm->nremembered++] = obj;
+  }
+
+  /* the value may be something the marker hasn't seen, black objects are
+     never looked at again otherwise */
+  if(vm->gc_state == ANA_GC_MARKING 
+      && (obj->flags & (ANA_GC_MARKED | ANA_GC_GRAY)) == ANA_GC_MARKED)
+    gray_push(vm, obj);
+}
+
 #include "object_ops.h"
 
 static __attribute__((unused)) void inspect_stack(ana_frame *frame)
@@ -178,20 +312,17 @@ static inline void trace_frame(ana_vm *vm, ana_frame *frame)
     }
 
     fprintf(stdout, "   %-15d%-13.25s%-11s\n", (int)i, sval, 
-      value->type->obj_name);
+      ana_type_of(value)->obj_name);
 
     ana_object_dtor(_sval);
   }
 
   fprintf(stdout, "  Jump Targets: \n");
   
-  ana_array_foreach(frame->jump_targets, i, value) {
-    ana_string *_sval = (ana_string *)ana_object_tostring(value);
-    char *sval = _sval->value;
-    fprintf(stdout, "   %-15d%-13.25s%-11s\n", (int)i, sval, 
-      value->type->obj_name);
-    ana_object_dtor(_sval);
-  } ana_array_foreach_end();
+  for(i = 0; i < frame->defn->jump_table_size; i++) {
+    fprintf(stdout, "   %-15d%-13u%-11s\n", (int)i, frame->jump_table[i], 
+      "offset");
+  }
 
   fprintf(stdout, "  VM Symbols:\n");
 
@@ -204,1752 +335,26 @@ static inline void trace_frame(ana_vm *vm, ana_frame *frame)
   fputc('\n', stdout);
 }
 
-static ana_object *ana_frame_eval(ana_vm *vm)
-{
-  ana_frame *frame;
-  ana_long **jmptargets;
-  ana_object **constants;
-  ana_object *locals;
+#define ANA_FRAME_EVAL ana_frame_eval_traced
+#define ANA_FRAME_EVAL_TRACED 1
+#include "frame_eval.h"
+#undef ANA_FRAME_EVAL
+#undef ANA_FRAME_EVAL_TRACED
 
-  ana_object *arg = NULL, *retval = NULL, *left, *right, *result;
+#define ANA_FRAME_EVAL ana_frame_eval_untraced
+#define ANA_FRAME_EVAL_TRACED 0
+#include "frame_eval.h"
+#undef ANA_FRAME_EVAL
+#undef ANA_FRAME_EVAL_TRACED
 
-  while(!COMO_VM_HAS_FRAMES())
-  {    
-    int current_line = 0;
-
-    enter:
-    assert(vm->stackpointer > 0);
-    
-    frame = COMO_VM_POP_FRAME();
-    vm->base_frame = frame;
-
-    unsigned int *code = frame->code;
-    jmptargets = (ana_long **)(((ana_array *)frame->jump_targets)->items);
-    constants = (ana_object **)(((ana_array *)vm->constants)->items);
-    locals = frame->locals;
-
-    if(vm->flags & COMO_VM_TRACING_ANY)
-      trace_frame(vm, frame);
-
-    ana_uint32_t opline;
-    ana_uint32_t opcode;
-    int next_op_code;
-    short oparg;
-    unsigned opflag;
-
-    for(;;) {
-      top:
-      fetch();
-
-      vm_case(opcode) {
-        default: {
-          Ana_SetError("VMError", "Opcode %#04x is not implemented", opcode);
-          vm_continue();
-        }
-        vm_target(IIMPORT)
-        {
-          ana_object *alias = pop();
-          ana_object *path = ana_array_get(vm->constants, (long)oparg);
-
-          if(import_file(vm, frame, alias, path) != 0)
-          {
-            vm_continue();
-          }
-          else
-          {
-            goto enter;
-          }
-        }        
-        vm_target(ITER) {
-          /* This is the container */
-          ana_object *iterable = pop();
-
-          /* the container is already part of the GC root*/
-
-          if(iterable->type->obj_iter == NULL)
-          {
-            set_except("TypeError", "%s object is not iterable",
-              ana_type_name(iterable));
-          }
-          else
-          {
-            ana_object *iterator = iterable->type->obj_iter(iterable);
-            
-            /* The iterator is tracked */
-            GC_TRACK(vm, iterator);
-
-            /* We must hold a reference to it because it will be 
-               reachable for the entire duration of this loop */
-            iterator->refcount++;
-
-            push(iterator);
-
-          }
-
-          vm_continue();   
-        }
-        vm_target(ITER_MV) {          
-          ana_object *iterator = pop();
-          
-          assert(iterator);
-          assert(iterator->type->obj_iter_next != NULL);
-
-          ana_object *next = iterator->type->obj_iter_next(iterator);
-
-          if(!next)
-          {
-            frame->pc = (*(jmptargets + oparg))->value;
-            
-            /* release lock on the iterator */
-            iterator->refcount--;
-
-            goto top;          
-          }
-          else
-          {
-            push(iterator);
-            push(next);
-          }
-
-          vm_continue();
-        }
-        vm_target(ILAND) {
-          ana_object *right = pop();
-          ana_object *left = pop();
-
-          if(!left->type->obj_bool(left))
-          {
-            /* This was falsy, so put this on the stack */
-            push(left);
-          }
-          else if(!right->type->obj_bool(right))
-          {
-            push(right);
-          }
-          else
-          {
-            push(right);
-          }
-
-          vm_continue();
-        }
-        vm_target(ILOR) {
-          // // operator, returns the first value that was true,
-          // else the right value is returned
-          //
-          ana_object *right = pop();
-          ana_object *left = pop();
-
-          /* left is true */
-          if(left->type->obj_bool(left))
-          {
-            push(left);
-
-            vm_continue();
-          }
-
-          if(right->type->obj_bool(right))
-          {
-            push(right);
-
-            vm_continue();
-          }   
-
-          push(right);
-
-          vm_continue();
-        }
-        vm_target(ILSHFT) {
-          ana_object *right = pop();
-          ana_object *left = pop();
-
-          if(left->type->obj_binops != NULL 
-            && left->type->obj_binops->obj_ls != NULL)
-          {
-            ana_object *res = left->type->obj_binops->obj_ls(left, right);
-
-            if(res)
-            {
-              push(res);
-            }
-          }
-          else
-          {
-
-            set_except("TypeError", "unsupported operands for << operator");
-          }
-
-          vm_continue();
-        }
-        vm_target(IRSHFT) {
-          ana_object *right = pop();
-          ana_object *left = pop();
-
-          if(left->type->obj_binops != NULL 
-            && left->type->obj_binops->obj_rs != NULL)
-          {
-            ana_object *res = left->type->obj_binops->obj_rs(left, right);
-
-            if(res)
-            {
-              push(res);
-            }
-          }
-          else
-          {
-
-            set_except("TypeError", "unsupported operands for >> operator");
-          }
-
-          vm_continue();
-        }
-        vm_target(IUNARYNOT) {
-          arg = pop();
-          
-          if(arg->type->obj_bool(arg) == 0)
-          {
-            push(ana_bool_true);
-          }
-          else
-          {
-            push(ana_bool_false);
-          }
-
-          vm_continue();
-        }
-        vm_target(IIN) {
-          ana_object *container = pop();
-          ana_object *index = pop();
-          ana_object *res = getindex(vm, container, index);
-
-          if(res)
-          {
-
-            push(res);
-          }
-
-          vm_continue();
-        }
-        vm_target(IUNARYMINUS) {
-          arg = pop();
-
-          if(arg->type->obj_unops != NULL 
-            && arg->type->obj_unops->obj_minus != NULL)
-          {
-            result = arg->type->obj_unops->obj_minus(arg);
-
-            if(result) 
-            {
-              GC_TRACK(vm, result);
-
-              push(result);
-            }
-            else
-              set_except("RuntimeError", "unsupported operand type for - operator");
-          }
-          else
-          {
-            set_except("RuntimeError", "unsupported operand type for - operator");
-          }
-
-          vm_continue();
-        }
-        vm_target(IUNARYPLUS) {
-          arg = pop();
-
-          if(arg->type->obj_unops != NULL 
-            && arg->type->obj_unops->obj_plus != NULL)
-          {
-            result = arg->type->obj_unops->obj_plus(arg);
-
-            if(result) {
-              GC_TRACK(vm, result);
-              push(result);
-            }
-            else
-              set_except("RuntimeError", "unsupported operand type for + operator");
-          }
-          else
-          {
-            set_except("RuntimeError", "unsupported operand type for + operator");
-          }
-
-          vm_continue();
-        }
-        vm_target(ITHROW) {
-          arg = pop();
-
-          ana_tostring_fast(arg, {
-            set_except("RuntimeError", value);
-          });
-
-          vm_continue();
-        }
-        vm_target(JMP) {
-          frame->pc = (*(jmptargets + oparg))->value;
-          goto top;
-        }
-        vm_target(JMPF) {
-          result = pop();
-          push(result);
-
-          if(result->type->obj_bool(result) == 0)
-          {     
-            frame->pc = (*(jmptargets + oparg))->value;
-            goto top;
-          }
-
-          vm_continue();
-        }
-        vm_target(JMPT) {
-          result = pop();
-          push(result);
-
-          if(result->type->obj_bool(result) != 0)
-          {     
-            frame->pc = (*(jmptargets + oparg))->value;
-            goto top;
-          }
-
-          vm_continue();
-        }
-        vm_target(JMPZ) {
-          result = pop();
-          
-          assert(result);
-
-          if(LIKELY(result->type == &ana_bool_type))
-          {
-            if(!(((ana_bool *)result)->value))
-            {
-              frame->pc = (*(jmptargets + oparg))->value;
-              goto top;
-            }
-            else
-            {
-              goto done;
-            }
-          } 
-
-          if(result->type->obj_bool(result) == 0)
-          {     
-            frame->pc = (*(jmptargets + oparg))->value;
-            goto top;
-          }
-
-          done:
-          vm_continue();
-        }
-        vm_target(BEGIN_LOOP) {
-          /* TODO need to check if need resize */
-          ana_basic_block *loop = malloc(sizeof(*loop));
-          loop->stack_obj_count = 0;
-          loop->next = frame->loop->root;
-          frame->loop->root = loop;
-
-          assert(frame->loop->stack_position < frame->loop->stack_capacity);
-
-          frame->loop->stack[frame->loop->stack_position++] = loop;
-          frame->loop->stack_size++;
-
-          vm_continue();
-        }
-        vm_target(EXIT_LOOP_CONTINUE) {       
-          /* all of pushs to this tack inside the block, need to be poped 
-             if they weren't already
-            */
-          if(frame->loop->stack[frame->loop->stack_position - 1]->stack_obj_count < 0)
-            frame->loop->stack[frame->loop->stack_position - 1]->stack_obj_count = 0;
-
-          ana_size_t sz = frame->loop->stack[frame->loop->stack_position - 1]
-              ->stack_obj_count;
-
-          ana_size_t i;
-
-          for(i = 0; i < sz; i++)
-          {
-            --frame->loop->stack[frame->loop->stack_position - 1]->stack_obj_count;
-
-            (void)xpop();
-          }
-
-          vm_continue();
-        }
-        vm_target(END_LOOP) {
-          /* now we must pop this loop block */
-          --frame->loop->stack_position;
-          --frame->loop->stack_size;
-          /* frame->sp must be the same as it was when starting the loop */
-          //printf("end of loop SP=%ld\n", frame->sp);
-          vm_continue();
-        }
-        vm_target(TRY) {
-          int arg = get_arg();
-          /* Arg is the index into the jmptargets table */
-          ana_object *jmptargetobj = ana_array_get(frame->jump_targets,
-            (ana_size_t)arg);
-
-          ana_basic_block *tryblock = 
-            ana_basic_block_new((int)ana_get_long(jmptargetobj)->value);
-
-          tryblock->next = frame->exception->root;
-          frame->exception->root = tryblock;
-
-          frame->exception->stack[frame->exception->stack_position++] 
-            = tryblock;
-
-          frame->exception->stack_size++;
-
-          vm_continue();
-        }
-        vm_target(SETUP_CATCH) {
-          int cindex = get_arg();
-                    
-          if(ex == NULL) 
-          {
-            assert(ana_excep != NULL);
-          }
-
-          arg = get_const(cindex);
-          
-          assert(arg != NULL);
-          
-          ana_object *exvalue = ana_stringfromstring(ex == NULL ? ana_excep : ex);
-          
-          GC_TRACK(vm, exvalue);
-          
-          ana_map_put(frame->locals, arg, exvalue);
-          
-          if(ex) 
-          {
-            free(ex);
-          }
-          
-          if(ex)
-          {
-            ex = NULL;
-            ex_type = NULL;
-          }
-          else
-          {
-            free(ana_excep);
-            ana_excep = NULL;
-            ana_except_type = NULL;
-          }
-          
-          vm_continue();
-        }
-        vm_target(LOAD_SUBSCRIPT) {
-          ana_object *index = pop();
-          ana_object *container = pop();
-          ana_object *res = getindex(vm, container, index);
-
-          if(res == ANA_KEY_NOT_FOUND)
-          {
-            ana_tostring_fast(index, {
-              set_except("KeyError", "%s", value);
-            });
-          }
-          else if(res) 
-          {
-            push(res);
-          }
-          else
-          {
-            set_except("RuntimeError", "value does not support indexed access");
-          }
-
-          vm_continue(); 
-        }
-        vm_target(STORE_SUBSCRIPT) {
-          ana_object *value = pop();
-          ana_object *index = pop();
-          ana_object *container = pop();
-          ana_object *res = setindex(vm, container, index, value);
-          
-          if(res == ANA_KEY_NOT_FOUND)
-          {
-            set_except("KeyError", "index is out of range for assignment");
-          }
-          else if(!res)
-          {
-            set_except("RuntimeError", 
-              "indexed assignment is not supported for type '%s'", 
-              ana_type_name(container));
-          }
-          else
-          {
-            if(!opflag) 
-            {
-              push(res);
-            }
-          }
-
-          vm_continue();
-        }
-        vm_target(INITARRAY) {
-          result = ana_array_new(oparg);
-
-          while(oparg--)
-          {
-            left = pop();
-            
-            ana_array_push(result, left);
-            
-            incref_recursively(left);
-          }
-
-          GC_TRACK(vm, result);
-
-          push(result);
-          
-          vm_continue();
-        }
-        vm_target(INITOBJ) {
-          int arg = get_arg();
-          ana_object *obj = ana_map_new(arg > 0 ? arg : 2);
-
-          while(arg--)
-          {
-            ana_object *val = pop();
-            ana_object *key = pop();
-
-            assert(ana_type_is(key, ana_string_type));
-
-            ana_map_put(obj, key, val);
-
-            incref_recursively(val);
-          }
-
-          GC_TRACK(vm, obj);
-
-          push(obj);
-
-          vm_continue();
-        }
-        vm_target(SETPROP) {
-          arg = ana_array_get(vm->symbols, oparg);
-          assert(arg);
-          
-          ana_object *value = pop();          
-          ana_object *instance = pop();
-
-          if(ana_type_is(instance, ana_map_type))
-          {
-            ana_object *prev;
-            prev = ana_map_get(instance, arg);
-
-            if(prev)
-            {
-              if(prev->refcount > 0)
-                decref_recursively(prev);
-            }
-
-            ana_map_put(instance, arg, value);
-
-            incref_recursively(value);
-            
-            if(!opflag)  
-            {              
-              push(value);
-            }
-
-            vm_continue();
-          }
-
-          /* prevent arbitrary properties from begin defined on non class types */
-          if(!ana_type_is(instance, ana_instance_type))
-          {
-            Ana_SetError(InvalidOperation, "Can't set property on object of type %s",
-              ana_type_name(instance));
-          } 
-          else  
-          {
-
-
-            //--- Begin chained resolution --------------------------
-            ana_instance *ins = ana_get_instance(instance);
-            ana_object *res = NULL;
-
-            while(ins)
-            {
-              res = ana_map_get(ins->self->members, arg);
-
-              if(res)
-              {
-                Ana_SetError(AnaTypeError, "Property `%s` is read-only", 
-                  ana_cstring(arg));
-                
-                vm_continue();
-              }
-                
-              if(!res)
-              {
-                res = ana_map_get(ins->properties, arg);
-              }
-
-              if(res)
-              {
-                decref_recursively(res);
-
-                res = ana_map_put(ins->properties, arg, value);
-
-                incref_recursively(value);
-
-                break;
-              }
-
-              ins = ana_get_instance(ins->base_instance);
-            }
-
-
-            if(!res)
-            {
-              res = ana_map_put(
-                ana_get_instance(instance)->properties, 
-                arg, 
-                value
-              );
-            }
-
-            //----------------------------------------------------
-            if(!opflag)
-              push(res);
-          } 
-          vm_continue();
-        }
-        vm_target(GETPROP) {
-          int argvalue = get_arg();
-          ana_object *instance = pop();
-          arg = ana_get_array(vm->symbols)->items[argvalue];
-
-          if(ana_type_is(instance, ana_module_type))
-          {
-            ana_object *res = ana_map_get(ana_get_module(instance)->members, 
-              arg);
-
-            if(res)
-            {
-              push(res);
-            }
-            else
-            {
-              set_except("KeyError", "%s", ana_cstring(arg));
-            }              
-          }
-          else if(ana_type_is(instance, ana_map_type)) 
-          {
-            ana_object *res = ana_map_get(instance, arg);
-
-            if(res)
-            {
-              push(res);
-            }
-            else
-            {
-              set_except("KeyError", "%s", ana_cstring(arg));
-            }
-          }
-          else if(instance->type->obj_props != NULL)
-          {
-            ana_object *res = ana_map_get(instance->type->obj_props, arg);
-
-            if(res) 
-            {
-              /* NO GC, since these are only builtin methods, sometimes */
-              push(res);
-            }
-            else
-            {
-              set_except("RuntimeError", "can't get property on object of type %s"
-              ,ana_type_name(instance)); 
-            }
-          }
-          else if(ana_type_is(instance, ana_instance_type))
-          {
-            /* Method resolution for GETPROP on instances
-             * 
-             * class definition, functions 
-             * properties
-             * locals
-             */
-
-            //--- Begin chained resolution --------------------------
-            ana_instance *ins = ana_get_instance(instance);
-            ana_object *res = NULL;
-
-            while(ins)
-            {
-
-              assert(ins->self);
-              assert(ins->self->members);
-
-              res = ana_map_get(ins->self->members, arg);
-
-              if(!res)
-              {
-                res = ana_map_get(ins->properties, arg);
-              }
-
-              if(res)
-                break;
-
-              ins = ana_get_instance(ins->base_instance);
-            }
-            //----------------------------------------------------
-
-            if(!res)
-            {
-              Ana_SetError(AnaRuntimeError, "%s is not defined on %s instance",
-                ana_get_string(arg)->value, 
-                ana_cstring(ana_get_instance(instance)->self->name));
-            }
-            else
-            {
-              if(ana_type_is(res, ana_function_type) && 
-                (next_op_code != CALL_METHOD))
-              {
-                res = ana_bounded_function_new(
-                  instance, ana_get_function(res)
-                );
-
-                GC_TRACK(vm, res);
-              }
-              push(res);
-            }
-          }
-          else 
-          {
-            Ana_SetError(AnaRuntimeError, "can't get property on object of type %s"
-              ,ana_type_name(instance));
-          }
-          
-          vm_continue();
-        }
-        vm_target(IRETURN) {
-          /* this is for early return value binding, for class constructors instances */
-          if(frame->retval)
-          {
-            arg = frame->retval;
-          }
-          else
-          {
-            arg = pop();
-          }
-
-          if(!COMO_VM_HAS_FRAMES())
-          {
-            ana_frame *caller = vm->stack[vm->stackpointer - 1];
-            
-            frame->retval = arg;
-
-            pushto(caller, arg);
-          }
-                  
-          goto exit; 
-        }
-        vm_target(LOAD_CONST) {
-          arg = ana_array_get(vm->constants, oparg);
-          push(arg);
-          vm_continue();
-        }
-        vm_target(STORE_NAME) {
-
-          ana_object *thename = ana_array_get(vm->symbols, oparg);
-          result = pop();
-          ana_object *oldvalue = NULL;
-          ana_instance *ins = NULL;
-
-          if(frame->self)
-          {
-            assert(ana_type_is(frame->self, ana_instance_type));
-
-            ins = ana_get_instance(frame->self);
-
-            while(ins)
-            {
-              oldvalue = ana_map_get(ins->self->members, arg);
-
-              if(oldvalue)
-              {
-                Ana_SetError(AnaTypeError, "Property `%s` is read-only", 
-                  ana_cstring(arg));
-                
-                vm_continue();
-              }
-                
-              if(!oldvalue)
-              {
-                oldvalue = ana_map_get(ins->properties, arg);
-              }
-
-              if(oldvalue)
-              {
-                break;
-              }
-
-              ins = ana_get_instance(ins->base_instance);
-            }
-
-          }
-          else
-          {
-            oldvalue = ana_map_get(locals, thename);
-          }
-
-
-          if(oldvalue)
-          {
-
-            decref_recursively(ana_get_base(oldvalue));          
-          }       
-
-
-          if(!frame->self)
-          {
-            ana_map_put(locals, thename, result);
-          }
-          else
-          {
-            ana_map_put(ana_get_instance(frame->self)->properties, thename, result);
-          }
-
-          result->refcount++;
-
-          if(!opflag) 
-          {
-            push(result);
-          }
-
-          vm_continue();
-        }
-        vm_target(LOAD_NAME) {
-          ana_object *thename  = ana_array_get(vm->symbols, oparg);
-          ana_object *result   = ana_map_get(frame->locals, thename);
-
-          if(!result && frame->self != NULL)
-          {
-            assert(ana_type_is(frame->self, ana_instance_type));
-
-            ana_instance *instance = (ana_instance *)frame->self;
-
-            result = ana_map_get(instance->properties, thename);
-          }
-
-          if(!result)
-          {
-            if(frame->globals) 
-            {
-              result = ana_map_get(frame->globals, thename);
-            }
-          }
-
-          if(!result && frame->self && ana_get_instance(frame->self)->module)
-          {
-            result = ana_map_get(ana_get_instance(frame->self)->module->members, 
-              thename);
-          }
-          if(!result && frame->module)
-          {
-            result = ana_map_get(frame->module->members, 
-              thename);
-          }
-
-          if(result) 
-          {
-            push(result);
-          }
-          else 
-          {
-            Ana_SetError(AnaNameError, "undefined variable '%s'", 
-              ana_cstring(thename));
-          }
-          
-          vm_continue();
-        }
-        vm_target(IDIV) {
-          right = pop();
-          left  = pop();
-
-          result = do_div(vm, left, right);
-
-          if(result) {
-            push(result);
-          }
-          else
-            set_except("RuntimeError", "unsupported operands for / operator");
-          vm_continue();       
-        }
-        vm_target(IEQUAL) {
-          right = pop();
-          left  = pop();
-          result = NULL;
-
-          if(left->type->obj_compops != NULL 
-                && left->type->obj_compops->obj_eq != NULL)
-          {
-            /*
-              result does not need to be GC'd because it is an instance of 
-              bool 
-             */
-            result = left->type->obj_compops->obj_eq(left, right);
-            if(result)
-            {
-              push(result);
-            }
-          }
-          else
-          {
-            if(left == right)
-            {
-              push(ana_bool_true);
-            }
-            else
-            {
-              push(ana_bool_false);
-            }
-          }
-
-          vm_continue();
-        }
-        vm_target(INEQUAL) {
-          right = pop();
-          left  = pop();
-          result = NULL;
-
-          if(left->type->obj_compops != NULL 
-                && left->type->obj_compops->obj_neq != NULL)
-          {
-            /* this will return the singelton bool instance */
-            result = left->type->obj_compops->obj_neq(left, right);
-          }
-
-          if(result)
-          {
-            push(result);
-          }
-          else
-          {
-            if(left != right)
-            {
-              push(ana_bool_true);
-            }
-            else
-            {
-              push(ana_bool_false);
-            }
-          }
-
-          vm_continue();
-        }
-        vm_target(IREM) {
-          right = pop();
-          left  = pop();
-          result = NULL;
-
-          if(left->type->obj_binops != NULL 
-                && left->type->obj_binops->obj_rem != NULL)
-          {
-            result = left->type->obj_binops->obj_rem(left, right);
-          }
-
-          if(result)
-          {
-            GC_TRACK(vm, result);
-
-            push(result);
-          }
-          else
-          {
-            set_except("NotImplementedError", "%% operation is not implemented"
-              "for type %s", ana_type_name(left));
-          }
-
-          vm_continue();
-        }  
-        vm_target(IADD) {
-
-          /* Here we have a reference to two objects that may
-             have been GC allocated */
-          right = pop();
-          left  = pop();
-
-          result = NULL;
-
-          if(ana_type_check_both(left, right, ana_long_type))
-          {
-            long val = ana_get_long(left)->value + ana_get_long(right)->value;
-            
-            result = ana_longfromlong(val);
-          } 
-          else 
-          {
-            if(left->type->obj_binops != NULL 
-              && left->type->obj_binops->obj_add != NULL) 
-                result = left->type->obj_binops->obj_add(left, right);
-          }
-
-          if(result) 
-          {
-            /* what happens here, is that we've pushed an 
-               object onto the stack, then call GC, 
-               this will mark the current object, but we need it later on
-            */
-            GC_TRACK(vm, result);
-            /* GC_TRACK may run the GC, then add this object to the root
-               it's important that the push happens after, since push
-                increases the stack pointer 
-             */
-            push(result);
-          }
-          else
-            set_except("RuntimeError", "unsupported operands for + operator");
-          
-          vm_continue();
-        }
-        vm_target(ILT) {
-          right = pop();
-          left  = pop();
-
-          result = NULL;
-
-          if(ana_type_check_both(left, right, ana_long_type))
-          {
-            if(ana_get_long(left)->value < ana_get_long(right)->value)
-              result = ana_bool_true;
-            else
-              result = ana_bool_false;    
-
-            push(result);
-          }
-          else if(left->type->obj_compops != NULL 
-              && left->type->obj_compops->obj_lt != NULL) 
-          {
-            /* this is just a boolean which only exists in a singleton */
-            /* do not add to GC */
-            result = left->type->obj_compops->obj_lt(left, right);
-            
-            if(result) 
-            {
-              push(result);
-            }
-
-            vm_continue();
-          }
-          else
-          {
-            set_except("TypeError", "unsupported operands for < operator");
-          }
-
-          vm_continue(); 
-        }
-        vm_target(IGT) {
-          right = pop();
-          left  = pop();
-
-          result = NULL;
-
-          if(ana_type_check_both(left, right, ana_long_type))
-          {
-            if(ana_get_long(left)->value > ana_get_long(right)->value)
-              result = ana_bool_true;
-            else
-              result = ana_bool_false; 
-
-            push(result);
-          }
-          else if(left->type->obj_compops != NULL 
-              && left->type->obj_compops->obj_lt != NULL) 
-          {
-            /* this is just a boolean which only exists in a singleton */
-            /* do not add to GC */
-            result = left->type->obj_compops->obj_lt(left, right);
-
-            if(result)
-            {
-              push(result);
-            }
-
-            vm_continue();
-          }
-          else
-          {
-            set_except("TypeError", "unsupported operands for < operator");
-          }
-
-          vm_continue(); 
-        }
-        vm_target(ILTE) {
-          right = pop();
-          left  = pop();
-
-          result = NULL;
-
-          if(ana_type_check_both(left, right, ana_long_type))
-          {
-            if(ana_get_long(left)->value <= ana_get_long(right)->value)
-              result = ana_bool_true;
-            else
-              result = ana_bool_false;    
-
-            push(result);
-          }
-          else if(left->type->obj_compops != NULL 
-              && left->type->obj_compops->obj_lte != NULL) 
-          {
-            /* this is just a boolean which only exists in a singleton */
-            /* do not add to GC */
-            result = left->type->obj_compops->obj_lte(left, right);
-
-            if(result) 
-            {
-              /* bool objects aren't GC'd, there are only 2 instances throught 
-                 the entire run 
-               */
-              push(result);
-            }
-          }
-          else 
-          {
-            set_except("RuntimeError", "unsupported operands for <= operator");
-          }
-
-          vm_continue(); 
-        }
-        vm_target(IGTE) {
-          right = pop();
-          left  = pop();
-
-          result = NULL;
-
-          if(ana_type_check_both(left, right, ana_long_type))
-          {
-            if(ana_get_long(left)->value >= ana_get_long(right)->value)
-              result = ana_bool_true;
-            else
-              result = ana_bool_false;
-
-            push(result);
-          }
-          else if(left->type->obj_compops != NULL 
-              && left->type->obj_compops->obj_lte != NULL) 
-          {
-            /* this is just a boolean which only exists in a singleton */
-            /* do not add to GC */
-            result = left->type->obj_compops->obj_gte(left, right);
-
-            if(result)
-            {
-              push(result);
-            }
-          }
-          else 
-          {
-            set_except("RuntimeError", "unsupported operands for >= operator");
-          }
-
-          vm_continue();
-        }
-        vm_target(ITIMES) {
-          right = pop();
-          left  = pop();
-
-          result = mul(vm, left, right);
-
-          if(result) 
-          {
-            push(result);
-          }
-          else
-            set_except("RuntimeError", "unsupported operands for * operator");
-
-          vm_continue();
-        }
-        vm_target(IMINUS) {
-          right = pop();
-          left  = pop();
-
-          result = sub(vm, left, right);
-
-          if(result) 
-          {
-            push(result);
-          }
-          else
-            set_except("RuntimeError", "unsupported operands for - operator");
-
-          vm_continue();
-        }
-        vm_target(DEFINE_CLASS) {
-          ana_object *baseclass = NULL;
-
-          if(opflag)
-          {
-            baseclass = pop();
-          }
-
-          ana_object *name = pop();
-          ana_object *fncount = pop();
-          ana_class *theclass = (ana_class *)ana_class_new(baseclass, name);
-          long i = ana_get_long(fncount)->value;
-
-          while(i--)
-          {
-            ana_object *function_name = pop();
-            ana_object *function_code = pop();
-
-            ana_map_put(theclass->members, function_name, function_code);
-          }
-
-          ana_object *prev;
-
-          if((prev = ana_map_get(frame->locals, name)) != NULL)
-          {
-            decref_recursively(prev);
-          }
-
-          ana_map_put(frame->locals, name, (ana_object *)theclass);
-
-          ana_get_base(theclass)->refcount++;
-
-          GC_TRACK(vm, theclass);
-
-          vm_continue();
-        }
-        vm_target(DEFINE_FUNCTION) {
-          ana_object *name = pop();
-          ana_object *code = pop();
-          ana_map_put(frame->locals, name, code);
-          vm_continue();
-        }
-        vm_target(CALL_METHOD) {
-          ana_object *res = NULL;
-          ana_object *callable = pop();
-          ana_object *self = pop();
-          
-          int totalargs = oparg;
-
-          if(ana_type_is(callable, ana_function_type))
-          {
-            ana_function *func = ana_get_function(callable);
-
-            if((ana_get_function(callable)->flags & COMO_FUNCTION_LANG) 
-                == COMO_FUNCTION_LANG)
-            {
-              int totalargs = oparg;
-              ana_function *fn = ana_get_function(callable);
-        
-              struct _ana_function_def *call = fn->func;
-
-              ana_frame *execframe = ana_frame_new(
-                call->code,
-                call->code_size,
-                call->jump_targets, 
-                call->line_mapping, 
-                BASE_FRAME->locals,
-                fn->name, 
-                frame,
-                current_line,
-                frame->filename
-              );
-
-
-              if(setup_args(vm, frame, execframe, fn, totalargs) != 0)
-              {
-                ana_object_dtor(execframe);
-                vm_continue();
-              }
-
-              /* Make sure this isn't a module funciton */
-              if(ana_type_is(self, ana_instance_type))
-              {
-                /* figure out if this is the base or parent */
-                /* base instnace being null would mean this is the parent class
-                   , so this must be the child 
-                */
-
-                ana_instance *i = ana_get_instance(self);
-                ana_object *real_self = self;
-
-                while(i)
-                {                
-                  if(ana_map_get(i->self->members, fn->name) != NULL)
-                  {
-                    real_self = (ana_object *)i;
-                    break;
-                  }
-
-                  i = ana_get_instance(i->base_instance);
-                }
-
-                if(ana_get_instance(real_self)->base_instance != NULL)
-                  ana_map_put(execframe->locals, 
-                    vm->base_symbol, ana_get_instance(real_self)->base_instance);
-
-                ana_map_put(execframe->locals, 
-                  vm->self_symbol, real_self);
-
-                execframe->self = real_self;
-                ana_get_instance(execframe->self)->module= i->module;
-              }
-              
-              if(ana_type_is(self, ana_module_type))
-              {
-                execframe->module = ana_get_module(self);
-              }
-
-              COMO_VM_PUSH_FRAME(frame);
-              COMO_VM_PUSH_FRAME(execframe);
-
-              goto enter;            
-            }
-            else if( (ana_get_function(callable)->flags 
-                & COMO_FUNCTION_NATIVE_METHOD) == COMO_FUNCTION_NATIVE_METHOD)
-            {
-              if(ana_array_size(ana_get_function(callable)->method.m_parameters) 
-                  != (ana_size_t)totalargs)
-              {
-                 Ana_SetError(AnaArgumentError, "%s expects %ld argument(s), %d given",
-                  ana_cstring(ana_get_function(callable)->name), 
-                  ana_array_size(ana_get_function(callable)->method.m_parameters),
-                  totalargs);      
-
-                vm_continue();
-              }
-
-              ana_object *nativeargs = ana_array_new(4);
-
-              while(totalargs--)
-              {
-                ana_object *thearg = pop();
-
-                ana_array_push(nativeargs, thearg);
-              }
-
-              res = ana_get_function(callable)->method.m_handler(self, 
-                oparg == 1 ? ana_get_array(nativeargs)->items[0] : nativeargs);
-              
-              /* TODO flag to check if it's already tracked */
-              /* this value may already be tracked */
-              if(oparg > 0)
-              {
-                /* TODO Check to make sure the returned value is not an argument */
-                /* because the arguments on the stack may either be constants
-                   or already part of the GC root 
-                */
-                int found_reflected = 0;
-                int i;
-                for(i = 0; i < oparg; i++)
-                {
-                  /* To do this is single dimensional, will have bugs later */
-                  if(res == ana_get_array(nativeargs)->items[i])
-                  {
-                    found_reflected = 1;
-                    break;
-                  }
-                }
-
-                if(!found_reflected) 
-                {
-                  if(!res->is_tracked) 
-                  {
-                    GC_TRACK_DIMENSIONAL(vm, res);
-                  }
-                  //GC_TRACK(vm, res);
-                }
-              }
-              else
-              {
-                /* If this is already tracked this can be a bug */
-                /* for example:
-                 *
-                 * a search method, which takes a key and returns a value in an array
-                   that was already tracked, here we would track it twice.
-                   TODO make a flag where we say if it is already tracked
-                 */
-
-                /* is_this_tracked? */
-                
-                if(!res->is_tracked)
-                {
-                  GC_TRACK_DIMENSIONAL(vm, res);
-                }
-
-                //GC_TRACK(vm, res);
-              }
-
-              if(res)
-              {
-                push(res);
-              }
-
-              ana_object_dtor(nativeargs);
-            }
-            else if( (ana_get_function(callable)->flags & COMO_FUNCTION_NATIVE)
-              == COMO_FUNCTION_NATIVE)
-            {
-              /* this is a just a native function wrapper into a variable */
-            
-              ana_object *nativeargs = ana_array_new(4);
-
-              while(totalargs--)
-              {
-                ana_object *thearg = pop();
-
-                ana_array_push(nativeargs, thearg);
-              }       
-
-              ana_object *res = func->handler(nativeargs); 
-
-              if(res) 
-              {
-                GC_TRACK(vm, res);
-              }
-
-              ana_object_dtor(nativeargs);
-            }
-          }
-          else if(ana_type_is(callable, ana_class_type))
-          {
-            /* This happens on a class property assign to a class */
-            if(invoke_class(vm, callable, totalargs, frame, self) == 0)
-            {
-              vm_continue();
-            }
-            else
-            {
-              goto enter;
-            }
-          }
-          else
-          {
-            Ana_SetError(InvalidOperation, "Cannot call object of type `%s`",
-              ana_type_name(callable));
-
-            vm_continue();
-          }
-
-          vm_continue();
-        }
-        vm_target(CALL) {
-          ana_object *res = NULL;
-          ana_object *callable = pop();
-          ana_object *self = NULL;
-
-          if(ana_type_is(callable, ana_function_type) || 
-                ana_type_is(callable, ana_bounded_function_type)) 
-          {
-            if(invoke_function(vm, self, callable, oparg, frame) != 0)
-              vm_continue();
-            else
-              goto enter;
-          }
-          else if(ana_type_is(callable, ana_class_type))
-          {
-            /* This happens on a class property assign to a class */
-            if(invoke_class(vm, callable, (int)oparg, frame, NULL) == 0)
-            {
-              vm_continue();
-            }
-            else
-            {
-              goto enter;
-            }
-          }
-          else if(ana_type_is(callable, ana_instance_type))
-          {
-            // this will happen when a method calls base()
-            int totalargs = oparg;
-            ana_instance *instance = ana_get_instance(callable);
-            ana_class *class_defn = instance->self; 
-            ana_object *instance_name = class_defn->name;
-            ana_object *constructor = NULL;
-            /* ensure that base constructors are only called from 
-               child constructors
-            */
-            if(frame->self != NULL)
-            {
-              assert(ana_type_is(frame->self, ana_instance_type));
-
-              /* todo all base constructors need to be called */
-              constructor = ana_map_get(class_defn->members, instance_name);
-
-              if(constructor == NULL)
-              {
-                goto no_constructor_found;
-              }      
-
-              ana_instance *current_instance = ana_get_instance(frame->self);
-
-              /* prevent instances from being called outside
-                 constructors (e.g. in class methods)
-               */
-              if(!ana_object_equals(current_instance->self->name, frame->name))
-              {
-                Ana_SetError(InvalidOperation, 
-                  "Illegal invocation of %s.%s outside of %s.%s", 
-                   ana_cstring(instance_name),
-                   ana_cstring(instance_name),
-                   ana_cstring(ana_get_instance(frame->self)->self->name),
-                   ana_cstring(ana_get_instance(frame->self)->self->name)
-                );
-
-                goto call_exit;
-              }
-
-              /* Now we are sure this instance is being called inside a class constructor, but we now must check that this call is legal
-                 e.g. no passing instances to other classes */
-
-              /* perhaps, an instance won't be called in a constructor if it doesn't have a base */
-
-              if(current_instance->base_instance == NULL)
-              {
-                Ana_SetError(InvalidOperation, 
-                  "Illegal invocation of instance `%s`", ana_cstring(instance_name)
-                );
-
-                goto call_exit;               
-              }
-
-              /* Now check that this target instance call is an immediate parent of this current instance */
-
-              ana_instance *parent_instance = (ana_instance *)current_instance->base_instance;
-
-              if(!ana_object_equals(parent_instance->self->name, instance->self->name))
-              {
-                 Ana_SetError(InvalidOperation, 
-                  "Illegal invocation of instance `%s`, as it's not an immediate parent of `%s`", 
-                  ana_cstring(instance_name),
-                  ana_cstring(current_instance->self->name)
-                );
-
-                goto call_exit;
-              }
-
-
-              if(constructor == NULL)
-              {
-                no_constructor_found:
-                Ana_SetError(AnaTypeError, 
-                  "constructor for class %s is not defined", 
-                  ana_cstring(class_defn->name));   
-
-                goto call_exit;            
-              }
-              else
-              {
-                ana_function *c_func = ana_get_function(constructor);
-                ana_function_defn *c_func_def = c_func->func;
-        
-                ana_frame *execframe = ana_frame_new(
-                  c_func_def->code,
-                  c_func_def->code_size,
-                  c_func_def->jump_targets, 
-                  c_func_def->line_mapping, 
-                  BASE_FRAME->locals,
-                  c_func->name, 
-                  frame,
-                  current_line,
-                  frame->filename
-                );
-
-                ana_map_put(execframe->locals, 
-                  vm->self_symbol, (ana_object *)instance);
-
-                if(c_func_def->parameters != NULL)
-                {
-                  if(ana_get_array(c_func_def->parameters)->size != totalargs)
-                  {
-                    Ana_SetError(
-                      AnaArgumentError, "%s expects %lu argument(s), %d given",
-                      ana_get_fn_name(execframe), 
-                      ana_get_array(c_func_def->parameters)->size,
-                      totalargs);
-                    
-                    goto call_exit;
-                  }
-                }
-                else if(totalargs != 0)
-                {
-                  Ana_SetError(
-                    AnaArgumentError, "%s expects 0 argument(s), %d given",
-                    ana_get_fn_name(execframe), totalargs);
-
-                  goto call_exit;
-                }
-
-                while(totalargs--)
-                {
-                  ana_object *theargvalue = pop();
-
-                  theargvalue->refcount++;
-
-                  ana_object *paramname = ana_array_get(
-                    c_func_def->parameters, (ana_size_t)totalargs);
-
-                  ana_map_put(execframe->locals, paramname, theargvalue);
-                }
-
-                /* TODO, if there is a base instance, put this in 
-                   as "base" variable 
-                */
-                execframe->self = (ana_object *)instance;
-
-                COMO_VM_PUSH_FRAME(frame);
-                COMO_VM_PUSH_FRAME(execframe);
-
-                goto enter;
-              }
-            }
-            else
-            {
-              Ana_SetError(InvalidOperation, 
-                "Can't call instance type outside of a class constructor");
-            }
-          }
-          else
-          { 
-            Ana_SetError(InvalidOperation, "Cannot call object of type `%s`",
-              ana_type_name(callable));
-
-            goto call_exit;
-          }
-
-          if(res)
-            push(res);
-
-          call_exit:
-          vm_continue();
-        }
-      }
-
-      if(ex || ana_excep) 
-      {
-        char *the_message = ex ==  NULL ? ana_excep : ex;
-        char *the_type = ex_type == NULL ? ana_except_type : ex_type;
-
-        ana_frame *thisframe = frame;
-        ana_frame *originalframe = frame;
-
-        while(thisframe != NULL) 
-        {
-
-          ana_basic_block *block;
-          
-          while(!(thisframe->exception->stack_position == 0))
-          {
-            block = thisframe->exception->stack[--thisframe->exception->stack_position];
-
-            thisframe->pc = (ana_size_t)block->jmpto;
-            
-            /* do finalization here */
-            
-            /* frame that threw the exception */
-            /* code won't continue from there */
-            if(originalframe != thisframe)
-            {
-              while(!(originalframe->sp == 0)) 
-              {
-                ana_object *temp = pop2(originalframe);
-
-                assert(temp);
-
-                decref_recursively(temp);
-              }
-
-              ana_map_foreach(originalframe->locals, key, value) 
-              {
-                (void)key;
-
-                decref_recursively(value);
-
-              } ana_map_foreach_end();
-
-              /* finalize this frame, as we won't be returning*/
-              ana_object_finalize(originalframe);
-              ana_object_dtor(originalframe);
-              vm->base_frame = NULL;
-            }
-
-            /* frame with the exception handler */
-            /* If the exception handler wasn't located in the current executing frame */
-            COMO_VM_PUSH_FRAME(thisframe);
-
-            goto enter; 
-          } 
-
-          if(!COMO_VM_HAS_FRAMES()) 
-          {
-            thisframe = COMO_VM_POP_FRAME();
-          }
-          else
-          {
-            thisframe = NULL;
-          }
-        }
-        int current_line;
-        ana_object *pc = ana_longfromlong((long)frame->pc);
-        ana_object *theline = ana_map_get(frame->line_mapping, pc);
-        
-        if(theline) {
-          current_line = (int)ana_get_long(theline)->value;
-          frame->current_line = current_line; 
-        }
-        else {
-          current_line = 0;
-        }
-
-        ana_object_dtor(pc);
-
-        ana_object *filename;    
-
-        if(frame->self && ana_get_instance(frame->self)->module)
-        {
-          filename = ana_get_module(ana_get_instance(frame->self)->module)->filename;
-        }
-        else
-        {
-          filename = frame->filename;
-        } 
-            
-        fprintf(stdout, "%s: %s\n    in %s:%d\n", 
-          the_type, 
-          the_message, 
-          ana_cstring(filename), 
-          current_line
-        );
-
-        free(ex);
-
-        ana_print_backtrace(frame);
-      
-        exit(1);
-      }
-    }
-
-    exit:
-    while(!empty()) 
-    {
-      ana_object *temp = pop();
-
-      assert(temp);
-
-      decref_recursively(temp);
-    }
-
-    ana_map_foreach(frame->locals, key, value) 
-    {
-      (void)key;
-
-      decref_recursively(value);
-    } ana_map_foreach_end();
-    
-    ana_object_finalize(frame);
-    ana_object_dtor(frame);
-    vm->base_frame = NULL;
-  }
+/* Tracing is selected once per evaluation, so untraced runs don't test
+   the tracing flags for every opcode */
+static ana_object *ana_frame_eval(ana_vm *vm)
+{
+  if(vm->flags & COMO_VM_TRACING_ANY)
+    return ana_frame_eval_traced(vm);
 
-  return retval;
+  return ana_frame_eval_untraced(vm);
 }
 
 static void ana_print_backtrace(ana_frame *frame)
@@ -1963,10 +368,11 @@ static void ana_print_backtrace(ana_frame *frame)
 
     char *fnname = ana_get_fn_name(fm);
 
-    fprintf(stdout, "\tat %s (%s:%ld)\n", 
+    /* the caller is suspended at the call that activated this frame */
+    fprintf(stdout, "\tat %s (%s:%d)\n", 
       fnname,
       ana_cstring(fm->filename),
-      fm->activation_line_number
+      fm->caller ? ana_frame_getline(fm->caller) : 0
     );
 
     free(fnname);
@@ -1976,209 +382,594 @@ static void ana_print_backtrace(ana_frame *frame)
   }
 }
 
-static void incref_recursively(ana_object *obj)
+/* A marking thread's objects to trace. The owner pushes and takes at the 
+   bottom, the others steal from the top (Chase and Lev). A buffer that's 
+   outgrown is kept until the end of the mark, a thief may still read it */
+typedef struct ana_gc_buffer {
+  struct ana_gc_buffer *prev;
+  long capacity;                /* a power of two */
+  ana_object *items[];
+} ana_gc_buffer;
+
+typedef struct ana_gc_worker {
+  struct ana_gc_pool *pool;
+  long top;
+  long bottom;
+  ana_gc_buffer *buffer;
+  unsigned int seed;            /* picks who to steal from */
+  pthread_t thread;
+  int started;
+  char pad[64];                 /* keeps the next worker's ends off this line */
+} ana_gc_worker;
+
+typedef struct ana_gc_pool {
+  ana_vm *vm;
+  ana_gc_worker *workers;
+  int nworkers;
+  int idle;                     /* workers with nothing to trace */
+  long next_root;               /* roots are taken by whoever comes first */
+  int trace_base_frame;
+} ana_gc_pool;
+
+/* The worker of the thread running, NULL outside of a parallel mark */
+static __thread ana_gc_worker *gc_worker;
+
+static ana_gc_buffer *gc_buffer_new(long capacity)
 {
+  ana_gc_buffer *buffer = malloc(sizeof(ana_gc_buffer) 
+    + sizeof(ana_object *) * capacity);
 
-  obj->refcount++;
+  buffer->prev = NULL;
+  buffer->capacity = capacity;
 
-  if(ana_type_is(obj, ana_array_type))
-  {
-    ana_array *array = ana_get_array(obj);
+  return buffer;
+}
+
+static ana_gc_buffer *deque_grow(ana_gc_worker *w, ana_gc_buffer *buffer, 
+  long top, long bottom)
+{
+  ana_gc_buffer *bigger = gc_buffer_new(buffer->capacity * 2);
+  long i;
+
+  for(i = top; i < bottom; i++)
+    bigger->items[i & (bigger->capacity - 1)] = 
+      buffer->items[i & (buffer->capacity - 1)];
+
+  bigger->prev = buffer;
+  __atomic_store_n(&w->buffer, bigger, __ATOMIC_RELEASE);
+
+  return bigger;
+}
+
+static void deque_push(ana_gc_worker *w, ana_object *obj)
+{
+  long bottom = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+  long top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+  ana_gc_buffer *buffer = w->buffer;
 
-    ana_size_t i;
+  if(bottom - top >= buffer->capacity)
+    buffer = deque_grow(w, buffer, top, bottom);
 
-    for(i = 0; i < array->size; i++)
+  __atomic_store_n(&buffer->items[bottom & (buffer->capacity - 1)], obj,
+    __ATOMIC_RELAXED);
+  __atomic_store_n(&w->bottom, bottom + 1, __ATOMIC_RELEASE);
+}
+
+static ana_object *deque_take(ana_gc_worker *w)
+{
+  long bottom = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+  ana_gc_buffer *buffer = w->buffer;
+  ana_object *obj = NULL;
+  long top;
+
+  __atomic_store_n(&w->bottom, bottom, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  top = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+
+  if(top <= bottom)
+  {
+    obj = __atomic_load_n(&buffer->items[bottom & (buffer->capacity - 1)],
+      __ATOMIC_RELAXED);
+
+    /* the last one, a thief may be after it too */
+    if(top == bottom)
     {
-      if(array->items[i] != obj)
-      { 
-        incref_recursively(array->items[i]);
-      }
-      else
-      {
-        array->items[i]->refcount++;
-      }
+      if(!__atomic_compare_exchange_n(&w->top, &top, top + 1, 0, 
+          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        obj = NULL;
+
+      __atomic_store_n(&w->bottom, bottom + 1, __ATOMIC_RELAXED);
     }
   }
-  else if(ana_type_is(obj, ana_map_type))
+  else
   {
-    ana_map_foreach(obj, key, value) {
-      
-      (void)key;
+    __atomic_store_n(&w->bottom, bottom + 1, __ATOMIC_RELAXED);
+  }
 
-      if(value != obj)
-      { 
-        incref_recursively(value);
-      }
-      else
-      {
-        value->refcount++;
-      }
+  return obj;
+}
 
-    } ana_map_foreach_end();
-  }
-  else if(ana_type_is(obj, ana_instance_type))
+/* NULL if w is empty or someone else got there first */
+static ana_object *deque_steal(ana_gc_worker *w)
+{
+  long top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+  long bottom;
+  ana_gc_buffer *buffer;
+  ana_object *obj;
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  bottom = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+
+  if(top >= bottom)
+    return NULL;
+
+  buffer = __atomic_load_n(&w->buffer, __ATOMIC_ACQUIRE);
+  obj = __atomic_load_n(&buffer->items[top & (buffer->capacity - 1)],
+    __ATOMIC_RELAXED);
+
+  if(!__atomic_compare_exchange_n(&w->top, &top, top + 1, 0, 
+      __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return NULL;
+
+  return obj;
+}
+
+static int deque_is_empty(ana_gc_worker *w)
+{
+  return __atomic_load_n(&w->top, __ATOMIC_ACQUIRE) 
+    >= __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+}
+
+/* Onto the gray stack, or the deque of the thread marking in parallel */
+static void mark_push(ana_vm *vm, ana_object *obj)
+{
+  if(gc_worker)
+    deque_push(gc_worker, obj);
+  else
+    gray_push(vm, obj);
+}
+
+/* Two threads can reach the same object, only the one that sets the mark 
+   traces it */
+static int mark_set(ana_vm *vm, ana_object *obj)
+{
+  if(gc_worker)
   {
-    ana_map_foreach(ana_get_instance(obj)->properties, key, value) {
-      
-      (void)key;
+    if(__atomic_load_n(&obj->flags, __ATOMIC_RELAXED) & vm->gc_skip)
+      return 0;
 
-      if(value != obj) 
-      {
-        incref_recursively(value);
-      }
-      else
-      {
-        value->refcount--;
-      }
+    return !(__atomic_fetch_or(&obj->flags, ANA_GC_MARKED, __ATOMIC_RELAXED)
+      & ANA_GC_MARKED);
+  }
 
-    } ana_map_foreach_end();
+  if(obj->flags & vm->gc_skip)
+    return 0;
 
-    if(ana_get_instance(obj)->base_instance)
-    {
-      incref_recursively(ana_get_instance(obj)->base_instance);
-    }
+  obj->flags |= ANA_GC_MARKED;
+
+  return 1;
+}
+
+static void mark_ex(ana_vm *vm, ana_object *obj);
+static int mark_slice(ana_vm *vm, long deadline);
+
+/* Frame locals and module members are owned maps that are never on the 
+   gc list, flagging them would stick since only sweep clears flags */
+static void mark_owned_map(ana_vm *vm, ana_object *owned)
+{
+  ana_map_foreach(owned, key, value) {
+
+    (void)key;
+
+    mark_ex(vm, value);
+
+  } ana_map_foreach_end();
+}
+
+/* Checking an item's flags is a cache miss on a wide array, the ones 
+   after it are fetched meanwhile */
+static void mark_items(ana_vm *vm, ana_array *array, ana_size_t from, 
+  ana_size_t to)
+{
+  ana_size_t i;
+
+  for(i = from; i < to; i++)
+  {
+    if(i + ANA_GC_PREFETCH < to)
+      PREFETCH(array->items[i + ANA_GC_PREFETCH]);
+
+    mark_ex(vm, array->items[i]);
   }
 }
 
-static void decref_recursively(ana_object *obj)
+/* Marks what obj references, but not obj */
+static void mark_children(ana_vm *vm, ana_object *obj)
 {
-  if(obj->refcount > 0)
-    obj->refcount--;
+  ana_type *type = obj->type;
 
-  if(ana_type_is(obj, ana_array_type))
+  if(type == &ana_array_type)
   {
     ana_array *array = ana_get_array(obj);
 
-    ana_size_t i;
+    /* A big array stays gray for a few chunks, it goes under what one 
+       reaches so that's traced while it's still in cache. The dirty index 
+       is where the next one starts, an incremental collection goes back 
+       only to what was written since it last looked */
+    ana_size_t from = array->dirty;
+    ana_size_t end = from + ANA_GC_ARRAY_CHUNK;
 
-    for(i = 0; i < array->size; i++)
-    {
-      if(array->items[i] != obj) 
-      {
-        decref_recursively(array->items[i]);
-      }
-      else
-      {
-        array->items[i]->refcount--;
-      }
-    }
+    if(end > array->size)
+      end = array->size;
+
+    /* set before another marking thread can steal the rest */
+    array->dirty = end;
+
+    if(end < array->size)
+      mark_push(vm, obj);
+
+    mark_items(vm, array, from, end);
   }
-  else if(ana_type_is(obj, ana_map_type))
+  else if(type == &ana_map_type)
   {
+    /* keys can be built at runtime, like "k" + i */
     ana_map_foreach(obj, key, value) {
       
-      (void)key;
-
-      if(value != obj) 
-      {
-        decref_recursively(value);
-      }
-      else
-      {
-        value->refcount--;
-      }
+      mark_ex(vm, key);
+      mark_ex(vm, value);
 
     } ana_map_foreach_end();
   }
-  else if(ana_type_is(obj, ana_instance_type))
+  else if(type == &ana_instance_type)
   {
-    ana_map_foreach(ana_get_instance(obj)->properties, key, value) {
-      
-      (void)key;
+    ana_instance_foreach(obj, value) {
 
-      if(value != obj) 
-      {
+      mark_ex(vm, value);
 
-        decref_recursively(value);
-      }
-      else
-      {
-        value->refcount--;
-      }
-
-    } ana_map_foreach_end();
+    } ana_instance_foreach_end();
 
     if(ana_get_instance(obj)->base_instance)
     {
-      decref_recursively(ana_get_instance(obj)->base_instance);
+      mark_ex(vm, ana_get_instance(obj)->base_instance);
     }
+
+    if(ana_get_instance(obj)->module)
+    {
+      mark_ex(vm, (ana_object *)ana_get_instance(obj)->module);
+    }
+  }
+  else if(type == &ana_module_type)
+  {
+    if(ana_get_module(obj)->members)
+      mark_owned_map(vm, ana_get_module(obj)->members);
+  }
+  else if(type == &ana_array_iterator_type)
+  {
+    mark_ex(vm, (ana_object *)((ana_array_iterator *)obj)->array);
+  }
+  else if(type == &ana_map_iterator_type)
+  {
+    mark_ex(vm, (ana_object *)((ana_map_iterator *)obj)->container);
+  }
+  else if(type == &ana_string_iterator_type)
+  {
+    mark_ex(vm, (ana_object *)((ana_string_iterator *)obj)->string);
   }
 }
 
-static void mark_ex(ana_object *obj)
+/* An old array is only written past its dirty index since the last 
+   collection, pushing to a big one doesn't make every minor collection
+   walk all of it */
+static void mark_remembered(ana_vm *vm, ana_object *obj)
 {
-  if(obj->flags)
+  if(ana_type_is(obj, ana_array_type))
+  {
+    ana_array *array = ana_get_array(obj);
+
+    mark_items(vm, array, array->dirty, array->size);
+  }
+  else
+  {
+    mark_children(vm, obj);
+  }
+}
+
+/* The types other than arrays mark_children looks into, anything else is 
+   done once it's marked */
+#define gc_has_children(type) \
+  ((type) == &ana_map_type \
+    || (type) == &ana_instance_type \
+    || (type) == &ana_module_type \
+    || (type) == &ana_array_iterator_type \
+    || (type) == &ana_map_iterator_type \
+    || (type) == &ana_string_iterator_type)
+
+/* Children are traced when obj comes off the gray stack, not from here, a 
+   deep graph doesn't make marking recurse */
+static void mark_ex(ana_vm *vm, ana_object *obj)
+{
+  ana_type *type;
+
+  if(ana_is_immortal(obj) || !mark_set(vm, obj))
     return;
 
-  obj->flags = 1;
+  /* obj isn't an immediate, its type is in the header */
+  type = obj->type;
 
-  if(ana_type_is(obj, ana_array_type))
+  /* all of it is traced the first time, by when its items are fetched */
+  if(type == &ana_array_type)
   {
-    ana_array *array = ana_get_array(obj);
+    ana_get_array(obj)->dirty = 0;
+    PREFETCH(ana_get_array(obj)->items);
+  }
+  else if(!gc_has_children(type))
+  {
+    return;
+  }
 
-    ana_size_t i;
+  mark_push(vm, obj);
+}
 
-    for(i = 0; i < array->size; i++)
-    {
-      if(!array->items[i]->flags)
-        mark_ex(array->items[i]);
-    }
+static void mark_frame(ana_vm *vm, ana_frame *frame)
+{
+  ana_size_t i;
+
+  ana_get_base(frame)->flags = ANA_GC_MARKED;
+
+  for(i = 0; i < frame->sp; i++)
+  {
+    mark_ex(vm, frame->stack[i]);
+  }
+
+  mark_owned_map(vm, frame->locals);
+
+  if(frame->self)
+    mark_ex(vm, frame->self);
+
+  /* a constructor returns the most derived instance, not its self */
+  if(frame->retval)
+    mark_ex(vm, frame->retval);
+
+  if(frame->module)
+    mark_ex(vm, (ana_object *)frame->module);
+
+  for(i = 0; i < frame->nlocals; i++)
+  {
+    if(frame->fastlocals[i])
+      mark_ex(vm, frame->fastlocals[i]);
   }
-  else if(ana_type_is(obj, ana_map_type))
+}
+
+/* Once every young object is either freed or promoted, no old object
+   references a young one */
+static void forget_remembered(ana_vm *vm)
+{
+  ana_size_t i;
+
+  for(i = 0; i < vm->nremembered; i++)
   {
-    ana_map_foreach(obj, key, value) {
-      
-      (void)key;
+    ana_object *obj = vm->remembered[i];
 
-      mark_ex(value);
+    obj->flags &= ~ANA_GC_REMEMBERED;
 
-    } ana_map_foreach_end();
+    if(ana_type_is(obj, ana_array_type))
+      ana_get_array(obj)->dirty = ana_get_array(obj)->size;
+  }
+
+  vm->nremembered = 0;
+}
+
+static void mark_roots(ana_vm *vm)
+{
+  ana_size_t i;
+
+  for(i = 0; i < vm->stackpointer; i++)
+  {
+    ana_frame *frame = vm->stack[i];
+
+    mark_frame(vm, frame);
   }
-  else if(ana_type_is(obj, ana_array_type))
+
+  if(vm->base_frame)
+    mark_frame(vm, vm->base_frame);
+}
+
+/* The lists of counted objects go first, they take the longest */
+#define ANA_GC_ROOT_OLD   0
+#define ANA_GC_ROOT_YOUNG 1
+#define ANA_GC_ROOT_BASE  2
+#define ANA_GC_ROOT_FRAME 3
+
+static void mark_root(ana_gc_pool *pool, long root)
+{
+  ana_vm *vm = pool->vm;
+  ana_object *obj;
+
+  switch(root)
+  {
+    case ANA_GC_ROOT_OLD:
+      for(obj = vm->old; obj != NULL; obj = obj->next)
+      {
+        if(obj->refcount > 0)
+          mark_ex(vm, obj);
+      }
+      break;
+    case ANA_GC_ROOT_YOUNG:
+      for(obj = vm->root; obj != NULL; obj = obj->next)
+      {
+        if(obj->refcount > 0)
+          mark_ex(vm, obj);
+      }
+      break;
+    case ANA_GC_ROOT_BASE:
+      if(pool->trace_base_frame)
+        mark_frame(vm, vm->base_frame);
+      break;
+    default:
+      mark_frame(vm, vm->stack[root - ANA_GC_ROOT_FRAME]);
+      break;
+  }
+}
+
+static ana_object *gc_steal(ana_gc_worker *self)
+{
+  ana_gc_pool *pool = self->pool;
+  int i, start;
+
+  self->seed = self->seed * 1103515245 + 12345;
+  start = (int)((self->seed >> 16) % (unsigned int)pool->nworkers);
+
+  for(i = 0; i < pool->nworkers; i++)
   {
-    ana_array_foreach(obj, index, value) {
+    ana_gc_worker *victim = &pool->workers[(start + i) % pool->nworkers];
+    ana_object *obj;
 
-      (void)index;
+    if(victim == self)
+      continue;
 
-      mark_ex(value);
+    obj = deque_steal(victim);
 
-    } ana_array_foreach_end();
+    if(obj)
+      return obj;
   }
-  else if(ana_type_is(obj, ana_instance_type))
+
+  return NULL;
+}
+
+static int gc_work_left(ana_gc_pool *pool)
+{
+  int i;
+
+  for(i = 0; i < pool->nworkers; i++)
   {
-    ana_map_foreach(ana_get_instance(obj)->properties, key, value) {
-      
-      (void)key;
+    if(!deque_is_empty(&pool->workers[i]))
+      return 1;
+  }
+
+  return 0;
+}
 
-      mark_ex(value);
+/* Takes roots until there are none left, then traces from its own deque 
+   and steals from the others'. An idle worker holds nothing and its deque 
+   is empty, there's nothing left to mark once they all are */
+static void *gc_worker_main(void *arg)
+{
+  ana_gc_worker *self = arg;
+  ana_gc_pool *pool = self->pool;
+  long nroots = ANA_GC_ROOT_FRAME + (long)pool->vm->stackpointer;
+  long root;
+  int spins;
 
-    } ana_map_foreach_end();
+  gc_worker = self;
 
-    if(ana_get_instance(obj)->base_instance)
+  while((root = __atomic_fetch_add(&pool->next_root, 1, __ATOMIC_RELAXED))
+      < nroots)
+    mark_root(pool, root);
+
+  for(;;)
+  {
+    ana_object *obj = deque_take(self);
+
+    if(!obj)
+      obj = gc_steal(self);
+
+    if(obj)
     {
-      mark_ex(ana_get_instance(obj)->base_instance);
+      mark_children(pool->vm, obj);
+      continue;
+    }
+
+    __atomic_add_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+
+    for(spins = 0;; spins++)
+    {
+      if(__atomic_load_n(&pool->idle, __ATOMIC_SEQ_CST) == pool->nworkers)
+      {
+        gc_worker = NULL;
+        return NULL;
+      }
+
+      if(gc_work_left(pool))
+      {
+        __atomic_sub_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+        break;
+      }
+
+      /* with more threads than cores, spinning takes the time of the 
+         ones that have work */
+      if(spins < ANA_GC_SPINS)
+      {
+        sched_yield();
+      }
+      else
+      {
+        struct timespec nap = { 0, 20000 };
+        nanosleep(&nap, NULL);
+      }
     }
   }
 }
 
-static void mark_frame(ana_frame *frame)
+/* A full collection that stops the program marks with vm->gc_threads 
+   threads, this one is the first of them. A thread that can't be started 
+   is counted as idle, the others take its share of the roots */
+static void mark_parallel(ana_vm *vm)
 {
+  ana_gc_pool pool;
   ana_size_t i;
+  int n;
 
-  ana_get_base(frame)->flags = 1;
+  pool.vm = vm;
+  pool.nworkers = vm->gc_threads;
+  pool.idle = 0;
+  pool.next_root = 0;
+  pool.trace_base_frame = vm->base_frame != NULL;
+  pool.workers = calloc(pool.nworkers, sizeof(ana_gc_worker));
 
-  for(i = 0; i < frame->sp; i++)
+  /* two threads shouldn't trace the same frame */
+  for(i = 0; i < vm->stackpointer; i++)
+  {
+    if(vm->stack[i] == vm->base_frame)
+      pool.trace_base_frame = 0;
+  }
+
+  for(n = 0; n < pool.nworkers; n++)
+  {
+    pool.workers[n].pool = &pool;
+    pool.workers[n].buffer = gc_buffer_new(ANA_GC_DEQUE_SIZE);
+    pool.workers[n].seed = (unsigned int)n + 1;
+  }
+
+  for(n = 1; n < pool.nworkers; n++)
+  {
+    ana_gc_worker *w = &pool.workers[n];
+
+    w->started = pthread_create(&w->thread, NULL, gc_worker_main, w) == 0;
+
+    if(!w->started)
+      __atomic_add_fetch(&pool.idle, 1, __ATOMIC_SEQ_CST);
+  }
+
+  gc_worker_main(&pool.workers[0]);
+
+  for(n = 0; n < pool.nworkers; n++)
   {
-    ana_object *obj = frame->stack[i];
+    ana_gc_buffer *buffer = pool.workers[n].buffer;
 
-    if(!obj->flags)
-      mark_ex(obj);
+    if(n > 0 && pool.workers[n].started)
+      pthread_join(pool.workers[n].thread, NULL);
+
+    while(buffer)
+    {
+      ana_gc_buffer *prev = buffer->prev;
+      free(buffer);
+      buffer = prev;
+    }
   }
 
-  mark_ex(frame->locals);
+  free(pool.workers);
 }
 
-static void mark(ana_vm *vm)
+static void mark(ana_vm *vm, int minor)
 {
   if(vm->flags & COMO_VM_GC_DISABLED) {
       #ifdef ANA_GC_DEBUG1
@@ -2189,90 +980,388 @@ static void mark(ana_vm *vm)
 
   ana_size_t i;
 
-  for(i = 0; i < vm->stackpointer; i++)
+  vm->gc_skip = minor ? (ANA_GC_MARKED | ANA_GC_OLD) : ANA_GC_MARKED;
+
+  if(!minor && vm->gc_threads > 1)
   {
-    ana_frame *frame = vm->stack[i];
+    mark_parallel(vm);
+    forget_remembered(vm);
+    return;
+  }
+
+  mark_roots(vm);
+
+  /* Reference counts are not transitive, an object referenced from a 
+     variable of a finished frame, a module or an iterator keeps what it 
+     contains alive through marking */
+  ana_object *obj;
 
-    mark_frame(frame);
+  for(obj = vm->root; obj != NULL; obj = obj->next)
+  {
+    if(obj->refcount > 0)
+      mark_ex(vm, obj);
   }
 
-  if(vm->base_frame)
-    mark_frame(vm->base_frame);
+  /* A minor collection takes old objects as live and doesn't trace them, 
+     the remembered ones are the only old objects that can reference a 
+     young one */
+  if(minor)
+  {
+    for(i = 0; i < vm->nremembered; i++)
+      mark_remembered(vm, vm->remembered[i]);
+  }
+  else
+  {
+    for(obj = vm->old; obj != NULL; obj = obj->next)
+    {
+      if(obj->refcount > 0)
+        mark_ex(vm, obj);
+    }
+  }
+
+  mark_slice(vm, 0);
+
+  /* the sweep frees or promotes every young object */
+  forget_remembered(vm);
+}
+
+/* Microseconds on a clock that doesn't jump */
+static long gc_clock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
-static void sweep(ana_vm *vm)
+/* The clock is only read every so many objects */
+#define ANA_GC_SLICE_CHECK 64
+
+/* Objects a slice gets through whatever the pause, the collection has to 
+   keep ahead of what's allocated between slices */
+#define ANA_GC_SLICE_MIN (ANA_GC_STEP * 4)
+
+#define gc_out_of_time(deadline, work) \
+  ((deadline) && ++(work) >= ANA_GC_SLICE_MIN \
+    && (work) % ANA_GC_SLICE_CHECK == 0 && gc_clock() >= (deadline))
+
+/* Frees the unreached objects of a generation. The young one is swept 
+   first, an iterator is younger than its container and still touches it 
+   when it's freed. Stops once the deadline, if any, has passed and returns 
+   where it stopped, the list is done when that's NULL */
+static ana_object **sweep(ana_vm *vm, ana_object **root, ana_size_t *count,
+  long deadline)
 {
+  ana_size_t work = 0;
+
   if(vm->flags & COMO_VM_GC_DISABLED) {
       #ifdef ANA_GC_DEBUG1
       fprintf(stderr, "sweep: not collecting because COMO_VM_GC_DISABLED is true\n");
       #endif
 
-    return;
+    return root;
   }
-  
-  ana_object **root = &vm->root;
 
   while (*root) 
   {    
-    if(!(*root)->flags) 
+    ana_object *obj = *root;
+
+    if(gc_out_of_time(deadline, work))
+      break;
+
+    /* it's possible that at the end of the frame
+       a value on the stack is also the same value as a local
+       in that moment the reference count can become 0,
+       however, if a value on the stack contains a reference to this
+       value, and also does the decrement, we would get to less than zero
+     */
+    if(!(obj->flags & ANA_GC_MARKED) && obj->refcount <= 0) 
     {
-      ana_object* unreached = *root; 
-            
-      assert(!ana_type_is(unreached, ana_function_type));
-
-      /* it's possible that at the end of the frame
-         a value on the stack is also the same value as a local
-         in that moment the reference count can become 0,
-         however, if a value on the stack contains a reference to this
-         value, and also does the decrement, we would get to less than zero
-       */
-      if(unreached->refcount <= 0) 
-      {
-        *root = unreached->next;
+      assert(!ana_type_is(obj, ana_function_type));
 
-        ana_object_dtor(unreached);
+      *root = obj->next;
 
-        vm->nobjs--;
-      }
-      else
-      {
-        #ifdef ANA_GC_DEBUG1
-        ana_object *str = ana_object_tostring(unreached);
-        printf("not releasing %p(%s, %s), it's reference count is %ld\n", 
-            (void *)unreached, ana_type_name(unreached), ana_cstring(str), unreached->refcount);
-        ana_object_dtor(str);
-        #endif
-        
-        root = &(*root)->next;
-      }
-    } 
-    else
+      ana_object_dtor(obj);
+
+      (*count)--;
+
+      continue;
+    }
+
+    #ifdef ANA_GC_DEBUG1
+    if(!(obj->flags & ANA_GC_MARKED))
     {
-      (*root)->flags = 0;
-      root = &(*root)->next;
+      ana_object *str = ana_object_tostring(obj);
+      printf("not releasing %p(%s, %s), it's reference count is %ld\n", 
+          (void *)obj, ana_type_name(obj), ana_cstring(str), obj->refcount);
+      ana_object_dtor(str);
     }
+    #endif
+
+    obj->flags &= ~ANA_GC_MARKED;
+    root = &obj->next;
   }
+
+  return root;
 }
 
+/* What survived the young generation moves to the old one */
+static void promote(ana_vm *vm)
+{
+  ana_object *obj = vm->root;
+
+  if(obj == NULL)
+    return;
+
+  for(;;)
+  {
+    obj->flags |= ANA_GC_OLD;
+
+    if(obj->next == NULL)
+      break;
+
+    obj = obj->next;
+  }
+
+  obj->next = vm->old;
+  vm->old = vm->root;
+  vm->nold += vm->nobjs;
+
+  vm->root = NULL;
+  vm->nobjs = 0;
+}
+
+/* Only the young generation, the cost follows what's alive in it */
+static void minor_gc(ana_vm *vm)
+{
+#ifdef ANA_GC_DEBUG
+  fprintf(stderr, "minor_gc: before sweep, nobjs=%ld\n", vm->nobjs);
+#endif
+
+  mark(vm, 1);
+
+  sweep(vm, &vm->root, &vm->nobjs, 0);
+
+  promote(vm);
+
+#ifdef ANA_GC_DEBUG
+  fprintf(stderr, "minor_gc: after sweep, nobjs=%ld, nold=%ld\n", 
+    vm->nobjs, vm->nold);
+#endif
+}
+
+/* Finishes a collection the incremental one left half done */
+static void gc_complete(ana_vm *vm);
+
 static void gc(ana_vm *vm)
 {
   if(vm->flags & COMO_VM_GC_DISABLED)
     return;
 
+  gc_complete(vm);
+
 #ifdef ANA_GC_DEBUG
-  fprintf(stderr, "gc: before sweep, nobjs=%ld\n", vm->nobjs);
+  fprintf(stderr, "gc: before sweep, nobjs=%ld, nold=%ld\n", 
+    vm->nobjs, vm->nold);
 #endif
 
-  mark(vm);
+  mark(vm, 0);
+
+  sweep(vm, &vm->root, &vm->nobjs, 0);
+  sweep(vm, &vm->old, &vm->nold, 0);
 
-  sweep(vm);
+  promote(vm);
+
+#ifdef ANA_GC_DEBUG
+  fprintf(stderr, "gc: after sweep, nobjs=%ld, nold=%ld\n", 
+    vm->nobjs, vm->nold);
+#endif
 
+  vm->mxold = vm->nold * 2 > ANA_GC_OLD_THRES 
+    ? vm->nold * 2 : ANA_GC_OLD_THRES;
+}
 
+/* An incremental collection works on the old generation with everything 
+   young promoted into it, no minor collection runs while it marks */
+static void gc_start(ana_vm *vm)
+{
 #ifdef ANA_GC_DEBUG
-  fprintf(stderr, "gc: after sweep, nobjs=%ld\n", vm->nobjs);
+  fprintf(stderr, "gc_start: nobjs=%ld, nold=%ld\n", vm->nobjs, vm->nold);
 #endif
 
-  vm->mxobjs = vm->mxobjs * 2;
+  promote(vm);
+  forget_remembered(vm);
+
+  vm->gc_skip = ANA_GC_MARKED;
+  vm->gc_state = ANA_GC_MARKING;
+  vm->gc_cursor = vm->old;
+
+  mark_roots(vm);
+}
+
+/* What was allocated since the last slice is shaded and joins the old 
+   generation. It's kept until the next collection, and the last step 
+   doesn't have to walk everything allocated while marking */
+static void shade_young(ana_vm *vm)
+{
+  ana_object *obj;
+
+  for(obj = vm->root; obj != NULL; obj = obj->next)
+  {
+    mark_ex(vm, obj);
+  }
+
+  promote(vm);
+}
+
+/* Traces gray objects, then the old ones that are counted, until the 
+   deadline. Returns 1 while there's work left. A collection that stops the 
+   program drains the gray stack with no deadline */
+static int mark_slice(ana_vm *vm, long deadline)
+{
+  ana_size_t work = 0;
+
+  for(;;)
+  {
+    ana_object *obj;
+
+    if(vm->ngray > 0)
+    {
+      obj = vm->gray[--vm->ngray];
+      obj->flags &= ~ANA_GC_GRAY;
+
+      mark_children(vm, obj);
+    }
+    else if(vm->gc_cursor)
+    {
+      obj = vm->gc_cursor;
+      vm->gc_cursor = obj->next;
+
+      if(obj->refcount > 0)
+        mark_ex(vm, obj);
+    }
+    else
+    {
+      return 0;
+    }
+
+    if(gc_out_of_time(deadline, work))
+      return 1;
+  }
+}
+
+/* Frames aren't behind a barrier, they're traced again along with what was 
+   allocated since the last slice, without a deadline. The old generation 
+   is then detached to be swept a slice at a time */
+static void gc_finish_mark(ana_vm *vm)
+{
+  mark_roots(vm);
+  shade_young(vm);
+
+  mark_slice(vm, 0);
+
+  forget_remembered(vm);
+
+  vm->gc_sweeping = vm->old;
+  vm->gc_sweep_at = &vm->gc_sweeping;
+  vm->old = NULL;
+  vm->gc_state = ANA_GC_SWEEPING;
+
+#ifdef ANA_GC_DEBUG
+  fprintf(stderr, "gc_finish_mark: nold=%ld\n", vm->nold);
+#endif
+}
+
+/* Minor collections run while the detached list is swept, what they 
+   promote is newer and stays in front of it */
+static void sweep_slice(ana_vm *vm, long deadline)
+{
+  ana_object **end = sweep(vm, vm->gc_sweep_at, &vm->nold, deadline);
+
+  if(*end)
+  {
+    vm->gc_sweep_at = end;
+    return;
+  }
+
+  if(vm->old)
+  {
+    ana_object *obj = vm->old;
+
+    while(obj->next)
+      obj = obj->next;
+
+    obj->next = vm->gc_sweeping;
+  }
+  else
+  {
+    vm->old = vm->gc_sweeping;
+  }
+
+  vm->gc_sweeping = NULL;
+  vm->gc_sweep_at = NULL;
+  vm->gc_state = ANA_GC_IDLE;
+
+#ifdef ANA_GC_DEBUG
+  fprintf(stderr, "sweep_slice: done, nold=%ld\n", vm->nold);
+#endif
+
+  vm->mxold = vm->nold * 2 > ANA_GC_OLD_THRES 
+    ? vm->nold * 2 : ANA_GC_OLD_THRES;
+}
+
+static void gc_complete(ana_vm *vm)
+{
+  if(vm->gc_state == ANA_GC_MARKING)
+    gc_finish_mark(vm);
+
+  if(vm->gc_state == ANA_GC_SWEEPING)
+    sweep_slice(vm, 0);
+}
+
+/* Called when the young generation is full. With a pause set, a major 
+   collection is done in slices of at most about that many microseconds */
+static void collect(ana_vm *vm)
+{
+  if(vm->flags & COMO_VM_GC_DISABLED)
+    return;
+
+  long deadline = vm->gc_pause ? gc_clock() + (long)vm->gc_pause : 0;
+
+  switch(vm->gc_state)
+  {
+    case ANA_GC_MARKING:
+      shade_young(vm);
+
+      if(!mark_slice(vm, deadline))
+        gc_finish_mark(vm);
+      break;
+    case ANA_GC_SWEEPING:
+      if(vm->nobjs >= ANA_GC_NURSERY_SIZE)
+        minor_gc(vm);
+      sweep_slice(vm, deadline);
+      break;
+    default:
+      if(vm->nold < vm->mxold)
+      {
+        minor_gc(vm);
+      }
+      else if(vm->gc_pause)
+      {
+        gc_start(vm);
+        mark_slice(vm, deadline);
+      }
+      else
+      {
+        gc(vm);
+      }
+      break;
+  }
+
+  /* slices come more often than minor collections */
+  vm->mxobjs = vm->gc_state == ANA_GC_IDLE 
+    ? ANA_GC_NURSERY_SIZE : vm->nobjs + ANA_GC_STEP;
 }
 
 static int trace_function(ana_vm *vm, char *function_name)
@@ -2292,7 +1381,7 @@ static int trace_function(ana_vm *vm, char *function_name)
     {
       ana_function *func = ana_get_function(value);
 
-      if(func->name->type->obj_equals(func->name, function_name_obj))
+      if(ana_type_of(func->name)->obj_equals(func->name, function_name_obj))
       {
         function = func;
 
@@ -2310,14 +1399,11 @@ static int trace_function(ana_vm *vm, char *function_name)
   ana_function_defn *func = ANA_GET_FUNCTION_DEF(function);
 
   ana_frame *firstframe = ana_frame_new(
-    func->code,
-    func->code_size,
-    func->jump_targets, 
-    func->line_mapping, 
+    vm,
+    func,
     NULL,
     function->name, 
     NULL,
-    0,
     function->filename
   );
 
@@ -2344,14 +1430,11 @@ int ana_eval(ana_vm *vm, ana_function *functionobj, char *function)
   }
 
   ana_frame *firstframe = ana_frame_new(
-    func->code,
-    func->code_size,
-    func->jump_targets, 
-    func->line_mapping, 
+    vm,
+    func,
     NULL,
     functionobj->name, 
     NULL,
-    0,
     functionobj->filename
   );
 